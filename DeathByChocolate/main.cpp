@@ -6,13 +6,181 @@
 #include <sstream>
 #include <chrono>
 #include <format>
+#include <atomic>
+#include <bit>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fstream>
+#include <deque>
+#include <algorithm>
+#include <climits>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #define __DEBUG
 #define __ENABLE_TRANSPOSITIONS
-static bool PRINTING_ALL = true;
-#define Log(msg, ...) if (PRINTING_ALL) std::cout << std::format(msg, __VA_ARGS__) << std::endl
+#define __CANONICAL_TRANSPOSITIONS
+
+// What main runs
+#define __WINMAP
+// #define __PARALLEL
+// #define __TABLEBASE
+// #define __PERSISTENT_TABLEBASE
+// #define __CROSS_CHECK
+// #define __BENCHMARK
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+
+// Anything below this level is compiled out entirely, its arguments are never evaluated
+#ifndef LOG_COMPILED_LEVEL
+#ifdef __DEBUG
+#define LOG_COMPILED_LEVEL LOG_LEVEL_DEBUG
+#else
+#define LOG_COMPILED_LEVEL LOG_LEVEL_INFO
+#endif
+#endif
+
+// Anything below this level is skipped at runtime, sweeps raise it to keep the search quiet
+static int LOG_RUNTIME_LEVEL = LOG_LEVEL_DEBUG;
+
+// Lines are queued and written to std::cout by a background thread, flushing once per batch
+// rather than once per line, so logging never blocks the caller on the console
+struct LogSink {
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable drained;
+	std::vector<std::string> pending;
+	bool writing = false;
+	bool stopping = false;
+	std::thread writer;
+
+	LogSink()
+	{
+		writer = std::thread([this]() { Run(); });
+	}
+
+	~LogSink()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+
+		wake.notify_one();
+		writer.join();
+	}
+
+	static LogSink& Get() {
+		static LogSink sink;
+
+		return sink;
+	}
+
+	void Write(std::string line) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			pending.push_back(std::move(line));
+		}
+
+		wake.notify_one();
+	}
+
+	// Blocks until everything logged so far is on the console
+	// Call before writing to std::cout directly, so output stays in order
+	void Flush() {
+		std::unique_lock<std::mutex> lock(mutex);
+		drained.wait(lock, [this]() { return pending.empty() && !writing; });
+	}
+
+	void Run() {
+		std::vector<std::string> batch;
+		std::unique_lock<std::mutex> lock(mutex);
+
+		while (true) {
+			wake.wait(lock, [this]() { return stopping || !pending.empty(); });
+
+			if (pending.empty() && stopping) {
+				break;
+			}
+
+			batch.swap(pending);
+			writing = true;
+			lock.unlock();
+
+			for (const std::string& line : batch) {
+				std::cout << line << '\n';
+			}
 
-// TODO: alpha/beta pruning
+			std::cout.flush();
+			batch.clear();
+
+			lock.lock();
+			writing = false;
+
+			if (pending.empty()) {
+				drained.notify_all();
+			}
+		}
+	}
+
+	// Delete copy operators
+	LogSink(const LogSink&) = delete;
+	LogSink& operator=(const LogSink&) = delete;
+};
+
+// Sets the runtime log level until the end of the scope
+struct ScopedLogLevel {
+	int previous_level;
+
+	ScopedLogLevel(int level)
+		: previous_level(LOG_RUNTIME_LEVEL)
+	{
+		LOG_RUNTIME_LEVEL = level;
+	}
+
+	~ScopedLogLevel()
+	{
+		LOG_RUNTIME_LEVEL = previous_level;
+	}
+};
+
+#define LogAtLevel(level, msg, ...) if (level >= LOG_RUNTIME_LEVEL) LogSink::Get().Write(std::format(msg, __VA_ARGS__))
+// Compiled out, but still refers to its arguments, so locals that are only logged don't become unused
+#define LogDisabled(msg, ...) if constexpr (false) LogSink::Get().Write(std::format(msg, __VA_ARGS__))
+
+#if LOG_COMPILED_LEVEL <= LOG_LEVEL_DEBUG
+#define LogDebug(msg, ...) LogAtLevel(LOG_LEVEL_DEBUG, msg, __VA_ARGS__)
+#else
+#define LogDebug(msg, ...) LogDisabled(msg, __VA_ARGS__)
+#endif
+
+#if LOG_COMPILED_LEVEL <= LOG_LEVEL_INFO
+#define LogInfo(msg, ...) LogAtLevel(LOG_LEVEL_INFO, msg, __VA_ARGS__)
+#else
+#define LogInfo(msg, ...) LogDisabled(msg, __VA_ARGS__)
+#endif
+
+#if LOG_COMPILED_LEVEL <= LOG_LEVEL_WARN
+#define LogWarn(msg, ...) LogAtLevel(LOG_LEVEL_WARN, "[WARN] " msg, __VA_ARGS__)
+#else
+#define LogWarn(msg, ...) LogDisabled("[WARN] " msg, __VA_ARGS__)
+#endif
+
+#define LogError(msg, ...) LogAtLevel(LOG_LEVEL_ERROR, "[ERROR] " msg, __VA_ARGS__)
+#define LogFlush() LogSink::Get().Flush()
 
 typedef uint16_t bar_t;
 typedef uint64_t hash_t;
@@ -28,6 +196,48 @@ struct Move {
 
 	Move(const Direction& dir, bar_t location)
 		: dir(dir), location(location) {}
+
+	bool operator==(const Move& other) const { return dir == other.dir && location == other.location; }
+};
+
+// Every valid split of a bar, generated on demand so searching never allocates
+// Horizontal splits 1..rows-1 come first, then vertical splits 1..columns-1
+struct MoveRange {
+	struct Iterator {
+		bar_t rows;
+		std::size_t index;
+
+		Move operator*() const {
+			if (index < (std::size_t)rows - 1) {
+				return Move(Move::Direction::HORIZONTAL, (bar_t)(index + 1));
+			}
+			else {
+				return Move(Move::Direction::VERTICAL, (bar_t)(index - (rows - 1) + 1));
+			}
+		}
+
+		Iterator& operator++() {
+			++index;
+
+			return *this;
+		}
+
+		bool operator!=(const Iterator& other) const { return index != other.index; }
+	};
+
+	bar_t rows;
+	bar_t columns;
+
+	MoveRange(bar_t rows, bar_t columns)
+		: rows(rows), columns(columns) {}
+
+	std::size_t size() const { return ((std::size_t)rows - 1) + ((std::size_t)columns - 1); }
+	bool empty() const { return size() == 0; }
+
+	Move operator[](std::size_t index) const { return *Iterator{ rows, index }; }
+
+	Iterator begin() const { return Iterator{ rows, 0 }; }
+	Iterator end() const { return Iterator{ rows, size() }; }
 };
 
 struct ChocolateBar {
@@ -37,10 +247,42 @@ struct ChocolateBar {
 	bar_t poison_row;
 	bar_t poison_column;
 
+	// Cached TableKey, kept up to date by MakeMove and UnmakeMove
+	hash_t table_key;
+
+#ifdef __CANONICAL_TRANSPOSITIONS
+	// CanonicalAxisHash of each axis, so a move only refolds the axis it split
+	hash_t row_hash;
+	hash_t column_hash;
+#endif
+
+	// Everything UnmakeMove needs to put a split back
+	// A split only changes the size and poison position along one axis
+	struct Undo {
+		Move::Direction dir;
+		bar_t size;
+		bar_t poison;
+		hash_t table_key;
+#ifdef __CANONICAL_TRANSPOSITIONS
+		hash_t axis_hash;
+#endif
+	};
+
 	ChocolateBar(bar_t _columns, bar_t _rows, bar_t _poison_column, bar_t _poison_row)
-		: rows(_rows), columns(_columns), poison_row(_poison_row), poison_column(_poison_column) {}
+		: rows(_rows), columns(_columns), poison_row(_poison_row), poison_column(_poison_column) {
+#ifdef __CANONICAL_TRANSPOSITIONS
+		row_hash = CanonicalAxisHash(rows, poison_row);
+		column_hash = CanonicalAxisHash(columns, poison_column);
+#endif
+		table_key = ComputeTableKey();
+	}
+
+	// One axis' fields of PositionHash, shifted up by 16 bits for the column axis
+	static hash_t AxisHash(bar_t size, bar_t poison) {
+		return (hash_t)size | (hash_t)poison << sizeof(bar_t) * 8 * 2;
+	}
 
-	hash_t PositionHash() {
+	hash_t PositionHash() const {
 		hash_t hash = 0;
 
 		hash |= (hash_t)rows;
@@ -51,12 +293,77 @@ struct ChocolateBar {
 		return hash;
 	}
 
+	// Inverse of PositionHash
+	static ChocolateBar FromPositionHash(hash_t hash) {
+		bar_t mask = (bar_t)~0;
+
+		return ChocolateBar(
+			(bar_t)(hash >> sizeof(bar_t) * 8) & mask,
+			(bar_t)hash & mask,
+			(bar_t)(hash >> sizeof(bar_t) * 8 * 3) & mask,
+			(bar_t)(hash >> sizeof(bar_t) * 8 * 2) & mask
+		);
+	}
+
+	// Index into a dense array of every position up to max_rows x max_columns
+	// Mirror images share a score, so only the poison's distance from the nearer edge of each axis is used
+	std::size_t DenseIndex(bar_t max_rows, bar_t max_columns) const {
+		bar_t canonical_poison_row = std::min<bar_t>(poison_row, rows - 1 - poison_row);
+		bar_t canonical_poison_column = std::min<bar_t>(poison_column, columns - 1 - poison_column);
+
+		std::size_t index = rows - 1;
+
+		index = index * max_columns + (columns - 1);
+		index = index * ((max_rows + 1) / 2) + canonical_poison_row;
+		index = index * ((max_columns + 1) / 2) + canonical_poison_column;
+
+		return index;
+	}
+
+	static std::size_t DenseIndexCount(bar_t max_rows, bar_t max_columns) {
+		return (std::size_t)max_rows * max_columns * ((max_rows + 1) / 2) * ((max_columns + 1) / 2);
+	}
+
+	// AxisHash shared by both mirror images of one axis
+	// Mirrors only swap the heaps either side of the poison, so put the poison in the nearer half
+	static hash_t CanonicalAxisHash(bar_t size, bar_t poison) {
+		return AxisHash(size, std::min<bar_t>(poison, size - 1 - poison));
+	}
+
+	// Transposing swaps the two axes, so put the smaller axis first, by size then poison
+	// Rotating an AxisHash by 32 bits puts its size above its poison, so comparing those compares in that order
+	static hash_t CombineAxisHashes(hash_t first_hash, hash_t second_hash) {
+		if (std::rotl(first_hash, 32) > std::rotl(second_hash, 32)) {
+			std::swap(first_hash, second_hash);
+		}
+
+		return first_hash | second_hash << sizeof(bar_t) * 8;
+	}
+
+	// Hash shared by every mirror image and transpose of this position, since they all have the same score
+	hash_t CanonicalPositionHash() const {
+		return CombineAxisHashes(CanonicalAxisHash(rows, poison_row), CanonicalAxisHash(columns, poison_column));
+	}
+
+	// Key this position is stored under in transposition tables
+	hash_t ComputeTableKey() const {
+#ifdef __CANONICAL_TRANSPOSITIONS
+		return CanonicalPositionHash();
+#else
+		return PositionHash();
+#endif
+	}
+
+	hash_t TableKey() const {
+		return table_key;
+	}
+
 	bool CheckLost() const {
 #ifdef __DEBUG
 		if (rows <= 1 && columns <= 1) {
 			// Check that the only square left is the poison square
 			if (!(poison_row == 0 && poison_column == 0)) {
-				Log("Poison square was not left!");
+				LogError("Poison square was not left!");
 			}
 
 			return true;
@@ -94,29 +401,88 @@ struct ChocolateBar {
 		}
 	}
 
-	std::vector<Move> GetValidMoves() const {
-		std::vector<Move> moves;
-
-		moves.reserve(rows * columns);
+	MoveRange GetValidMoves() const {
+		return MoveRange(rows, columns);
+	}
 
-		for (int row = 1; row < rows; row++) {
-			moves.emplace_back(Move::Direction::HORIZONTAL, row);
-		}
+	// Distances from the poison square to the left, right, top and bottom edges
+	// Every split shrinks exactly one of these, so the game is four independent Nim heaps
+	std::array<bar_t, 4> GetHeaps() const {
+		return {
+			poison_column,
+			(bar_t)(columns - 1 - poison_column),
+			poison_row,
+			(bar_t)(rows - 1 - poison_row)
+		};
+	}
 
-		for (int column = 1; column < columns; column++) {
-			moves.emplace_back(Move::Direction::VERTICAL, column);
-		}
+	bar_t NimSum() const {
+		std::array<bar_t, 4> heaps = GetHeaps();
 
-		return moves;
+		return heaps[0] ^ heaps[1] ^ heaps[2] ^ heaps[3];
 	}
 
-	void MakeMove(const Move& move) {
+	Undo MakeMove(const Move& move) {
+		Undo undo;
+
+		undo.dir = move.dir;
+		undo.table_key = table_key;
+
 		if (move.dir == Move::Direction::VERTICAL) {
+			undo.size = columns;
+			undo.poison = poison_column;
+
 			SplitVertical(move.location);
 		}
 		else {
+			undo.size = rows;
+			undo.poison = poison_row;
+
 			SplitHorizontal(move.location);
 		}
+
+#ifdef __CANONICAL_TRANSPOSITIONS
+		// Only the split axis needs folding again, which axis comes first can still change
+		if (move.dir == Move::Direction::VERTICAL) {
+			undo.axis_hash = column_hash;
+			column_hash = CanonicalAxisHash(columns, poison_column);
+		}
+		else {
+			undo.axis_hash = row_hash;
+			row_hash = CanonicalAxisHash(rows, poison_row);
+		}
+
+		table_key = CombineAxisHashes(row_hash, column_hash);
+#else
+		// Only the split axis' fields changed, swap them out of the key
+		if (move.dir == Move::Direction::VERTICAL) {
+			table_key ^= (AxisHash(undo.size, undo.poison) ^ AxisHash(columns, poison_column)) << sizeof(bar_t) * 8;
+		}
+		else {
+			table_key ^= AxisHash(undo.size, undo.poison) ^ AxisHash(rows, poison_row);
+		}
+#endif
+
+		return undo;
+	}
+
+	void UnmakeMove(const Undo& undo) {
+		if (undo.dir == Move::Direction::VERTICAL) {
+			columns = undo.size;
+			poison_column = undo.poison;
+#ifdef __CANONICAL_TRANSPOSITIONS
+			column_hash = undo.axis_hash;
+#endif
+		}
+		else {
+			rows = undo.size;
+			poison_row = undo.poison;
+#ifdef __CANONICAL_TRANSPOSITIONS
+			row_hash = undo.axis_hash;
+#endif
+		}
+
+		table_key = undo.table_key;
 	}
 
 	void Print() const {
@@ -156,6 +522,18 @@ struct ChocolateBar {
 	}
 };
 
+// splitmix64 finaliser, every bit of the input affects every bit of the output
+// Position hashes are bit-packed fields, so without this the low bits only ever see rows
+inline hash_t MixHash(hash_t hash) {
+	hash ^= hash >> 30;
+	hash *= 0xbf58476d1ce4e5b9ULL;
+	hash ^= hash >> 27;
+	hash *= 0x94d049bb133111ebULL;
+	hash ^= hash >> 31;
+
+	return hash;
+}
+
 struct TranspositionTable {
 	typedef std::size_t index_t;
 
@@ -163,451 +541,3872 @@ struct TranspositionTable {
 		// To get this hash, we'd have to have 65535 rows, 65535 columns, and the poison in an OOB square
 		static const hash_t INVALID_HASH = 0xffffffff;
 
+		// Whether score is exact, or only a bound because the search was cut off
+		enum Bound {
+			EXACT,
+			LOWER,
+			UPPER
+		};
+
 		hash_t position_hash = INVALID_HASH;
 		float score = 0.0f;
+		Bound bound = EXACT;
+
+		inline bool isInvalid() const { return position_hash == INVALID_HASH; }
+
+		// What a score found by searching with the window [alpha, beta] says about the true score
+		static Bound BoundForWindow(float score, float alpha, float beta) {
+			if (score <= alpha) { return UPPER; }
+			if (score >= beta) { return LOWER; }
+
+			return EXACT;
+		}
+
+		// Whether this entry decides the score for a search with the window [alpha, beta]
+		inline bool isUsable(float alpha, float beta) {
+			if (isInvalid()) { return false; }
 
-		inline bool isInvalid() { return position_hash == INVALID_HASH; }
+			switch (bound) {
+			case LOWER: return score >= beta;
+			case UPPER: return score <= alpha;
+			default: return true;
+			}
+		}
 	};
 
-	std::size_t table_size; // MAX SIZE
+	// Grow once the table is this full, linear probing slows down a lot past it
+	static constexpr float MAX_LOAD_FACTOR = 0.7f;
+	// Old slots moved into the new table per insert while growing, so no single insert stalls
+	// Must move the old table across before the new one needs to grow again
+	static const std::size_t MIGRATE_PER_INSERT = 4;
+	static const int MAX_ATTEMPTS = 100;
+	static const std::size_t DEFAULT_MAX_MEMORY = (std::size_t)256 * 1024 * 1024;
+	// Last bucket counts every probe at least this long
+	static const std::size_t PROBE_HISTOGRAM_SIZE = 16;
+
+	// Capacities are always powers of two, so indexing is a mask rather than a division
+	std::size_t table_size; // CURRENT CAPACITY
+	std::size_t max_table_size; // CAPACITY LIMIT FROM MEMORY CAP
 	std::size_t current_size = 0; // ACTUAL SIZE
 	Entry* data;
 
-	TranspositionTable(std::size_t table_size)
-		: table_size(table_size)
+	// Table we're growing out of, still searched by Lookup until every slot has been moved across
+	Entry* old_data = nullptr;
+	std::size_t old_table_size = 0;
+	std::size_t migrate_index = 0;
+
+	// Lookups made, and how many of them found the position
+	std::size_t lookup_count = 0;
+	std::size_t hit_count = 0;
+	// Entries overwritten because the table couldn't grow any further
+	std::size_t eviction_count = 0;
+	// How many slots each probe looked at before finding its position or an empty slot
+	std::array<std::size_t, PROBE_HISTOGRAM_SIZE> probe_histogram = {};
+	// Slots holding other positions that probes had to step past, and the most any one probe stepped past
+	std::size_t collision_count = 0;
+	std::size_t max_probe_length = 0;
+
+	// table_size is the starting capacity (rounded up to a power of two),
+	// the table doubles from there until it would use more than max_memory bytes
+	TranspositionTable(std::size_t table_size, std::size_t max_memory = DEFAULT_MAX_MEMORY)
+		: table_size(std::bit_ceil(table_size)),
+		max_table_size(std::max(std::bit_ceil(table_size), std::bit_floor(max_memory / sizeof(Entry))))
 	{
-		data = new Entry[table_size];
+		data = new Entry[this->table_size];
 
 		// Fill with empty
-		std::fill_n(data, table_size, Entry());
+		std::fill_n(data, this->table_size, Entry());
 	}
 
 	~TranspositionTable()
 	{
 		delete[] data;
+		delete[] old_data;
 	}
 
 	index_t GetIndex(hash_t position_hash) {
-		return position_hash % table_size;
+		return MixHash(position_hash) & (table_size - 1);
 	}
 
 	void Reset() {
 		std::fill_n(data, table_size, Entry());
-	}
 
-	Entry& AddEntry(hash_t position_hash, float score) {
-		if (current_size == table_size) {
-			Log("[WARN] Table completely filled! Ignoring call");
-			
-			return data[0];
-		}
+		delete[] old_data;
+		old_data = nullptr;
+		old_table_size = 0;
 
-		index_t index = GetIndex(position_hash);
+		current_size = 0;
+	}
 
-		Entry* pending_entry = &data[index];
+	// Linear probe for position_hash, returns the matching slot, or the first empty one,
+	// or nullptr if neither turned up within MAX_ATTEMPTS
+	Entry* Probe(Entry* entries, std::size_t size, hash_t position_hash) {
+		index_t mask = size - 1;
+		index_t index = MixHash(position_hash) & mask;
 
-		static const int MAX_ATTEMPTS = 100;
-		int attempts = 0;
+		for (int attempts = 0; attempts < MAX_ATTEMPTS; attempts++) {
+			Entry* test_entry = &entries[index];
 
-		// This entry already exists
-		while ((!pending_entry->isInvalid()) && attempts < MAX_ATTEMPTS) {
-			// Increment attempts
-			++attempts;
-			// Increment index (using skip factor of 1)
-			index = (index + 1) % table_size;
+			if (test_entry->position_hash == position_hash || test_entry->isInvalid()) {
+				++probe_histogram[std::min<std::size_t>(attempts, PROBE_HISTOGRAM_SIZE - 1)];
 
-			// NOTE: could increment the pointer instead, but might lead to some difficult errors
-			pending_entry = &data[index];
-		}
+				collision_count += attempts;
+				max_probe_length = std::max<std::size_t>(max_probe_length, attempts);
 
-		if (attempts >= MAX_ATTEMPTS) {
-			Log("Failed lookup from too many attempts");
+				return test_entry;
+			}
+
+			// Increment index (using skip factor of 1)
+			index = (index + 1) & mask;
 		}
 
-		// Found an empty entry, so set the position hash and score
-		pending_entry->position_hash = position_hash;
-		pending_entry->score = score;
+		++probe_histogram[PROBE_HISTOGRAM_SIZE - 1];
 
-		// Increment current size
-		++current_size;
+		collision_count += MAX_ATTEMPTS;
+		max_probe_length = std::max<std::size_t>(max_probe_length, MAX_ATTEMPTS);
 
-		// Return reference to that entry
-		return *pending_entry;
+		return nullptr;
 	}
 
-	Entry Lookup(hash_t position_hash) {
-		if (current_size == table_size) {
-			Log("[WARN] Table completely filled! Ignoring call");
+	bool IsGrowing() const { return old_data != nullptr; }
 
-			return Entry();
+	void StartGrowing() {
+		// Finish any growth still in progress first, there's only room to track one old table
+		while (IsGrowing()) {
+			MigrateSlots(old_table_size);
 		}
 
-		index_t index = GetIndex(position_hash);
+		old_data = data;
+		old_table_size = table_size;
+		migrate_index = 0;
 
-		Entry* test_entry = &data[index];
+		table_size = std::min(table_size * 2, max_table_size);
+		data = new Entry[table_size];
 
-		while (test_entry->position_hash != position_hash) {
-			// We found an empty entry
-			if (test_entry->position_hash == Entry::INVALID_HASH) {
-				return Entry();
-			}
+		std::fill_n(data, table_size, Entry());
 
-			index = (index + 1) % table_size;
-			
-			test_entry = &data[index];
-		}
+		current_size = 0;
 
-		return *test_entry;
+		LogDebug("Growing transposition table from {} to {} entries", old_table_size, table_size);
 	}
 
-	// Delete copy operators
-	TranspositionTable(const TranspositionTable&) = delete;
-	TranspositionTable& operator=(const TranspositionTable&) = delete;
-};
+	// Moves up to count slots out of the old table
+	// Old slots are left in place until the whole table is done, so probe chains through them stay intact
+	void MigrateSlots(std::size_t count) {
+		std::size_t end_index = std::min(old_table_size, migrate_index + count);
 
-std::string ReprMove(const Move& move) {
-	std::stringstream ss;
+		for (; migrate_index < end_index; migrate_index++) {
+			const Entry& old_entry = old_data[migrate_index];
 
-	if (move.dir == Move::Direction::HORIZONTAL) {
-		ss << "Horizontal split at: ";
-	}
-	else {
-		ss << "Vertical split at: ";
-	}
+			if (old_entry.isInvalid()) {
+				continue;
+			}
 
-	ss << move.location;
+			Entry* new_entry = Probe(data, table_size, old_entry.position_hash);
 
-	return ss.str();
-}
+			// Don't clobber anything stored since growing started, it's newer than what we have
+			if (new_entry != nullptr && new_entry->isInvalid()) {
+				*new_entry = old_entry;
 
-float Evaluate(ChocolateBar bar, int& positions_searched, TranspositionTable& table) {
-	std::vector<Move> moves = bar.GetValidMoves();
+				++current_size;
+			}
+		}
 
-	// Next person to move loses, so return a score of 1
-	if (moves.empty()) {
-		return 1;
+		if (migrate_index == old_table_size) {
+			delete[] old_data;
+			old_data = nullptr;
+			old_table_size = 0;
+		}
 	}
-	else {
-		float max_score = FLT_MAX;
-		float move_count = moves.size();
 
-		// Iterate possible moves
-		for (const Move& move : moves) {
-			ChocolateBar test_bar = bar;
+	// work is only used by tables with a replacement scheme
+	Entry& AddEntry(hash_t position_hash, float score, Entry::Bound bound = Entry::EXACT, [[maybe_unused]] uint16_t work = 0) {
+		bool at_memory_cap = table_size == max_table_size;
 
-			// Make move on our test bar
-			test_bar.MakeMove(move);
+		if (!at_memory_cap && current_size + 1 > table_size * MAX_LOAD_FACTOR) {
+			StartGrowing();
+		}
 
-			// Check if this state has already been evaluated
-#ifdef __ENABLE_TRANSPOSITIONS
-			hash_t position_hash = test_bar.PositionHash();
-			TranspositionTable::Entry entry = table.Lookup(position_hash);
+		if (IsGrowing()) {
+			MigrateSlots(MIGRATE_PER_INSERT);
+		}
 
-			// Means this position has been looked up before
-			if (!entry.isInvalid()) {
-				// So add score for that position to our total
-				max_score = std::min(max_score, entry.score);
-			}
-			// Otherwise evaluate state as normal, and add state to table
-			else {
-				// Get score for this state
-				float position_score = -Evaluate(test_bar, ++positions_searched, table);
+		Entry* pending_entry = Probe(data, table_size, position_hash);
 
-				// Add to lookup table
-				table.AddEntry(position_hash, position_score);
+		// Probe ran too long, there's still room to grow, so do that rather than evict anything
+		while (pending_entry == nullptr && !at_memory_cap) {
+			StartGrowing();
 
-				max_score = std::min(max_score, position_score);
-			}
+			at_memory_cap = table_size == max_table_size;
+			pending_entry = Probe(data, table_size, position_hash);
+		}
 
-#else
-			// Get score for next position
-			float position_score = -Evaluate(test_bar, ++positions_searched, table);
+		bool is_new = pending_entry == nullptr || pending_entry->isInvalid();
 
-			// Add score to our total
-			total_score += position_score;
-#endif
+		// Can't grow any more, so once we're too full to probe well, replace whatever's in our home slot
+		// Overwriting a slot (rather than emptying one) keeps every other probe chain intact
+		if (is_new && (pending_entry == nullptr || (at_memory_cap && current_size + 1 > table_size * MAX_LOAD_FACTOR))) {
+			pending_entry = &data[GetIndex(position_hash)];
+
+			if (!pending_entry->isInvalid()) {
+				++eviction_count;
+			}
+			else {
+				++current_size;
+			}
+		}
+		else if (is_new) {
+			++current_size;
 		}
 
-		// Calculate average score
-		// float average = total_score / move_count;
+		pending_entry->position_hash = position_hash;
+		pending_entry->score = score;
+		pending_entry->bound = bound;
 
-		// Return average score
-		return max_score;
+		// Return reference to that entry
+		return *pending_entry;
 	}
-}
 
-Move GetAIMove(ChocolateBar bar, TranspositionTable& table, float* move_score = nullptr) {
-	std::vector<Move> possible_moves = bar.GetValidMoves();
-
-	int total_searched = 0;
+	Entry Lookup(hash_t position_hash) {
+		++lookup_count;
 
-	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		Entry* test_entry = Probe(data, table_size, position_hash);
 
-	float best_move_score = -FLT_MAX;
-	Move* best_move = nullptr;
+		// Might not have been moved across yet
+		if ((test_entry == nullptr || test_entry->isInvalid()) && IsGrowing()) {
+			test_entry = Probe(old_data, old_table_size, position_hash);
+		}
 
-	if (move_score != nullptr) {
-		*move_score = -1.0f;
-	}
+		if (test_entry == nullptr || test_entry->isInvalid()) {
+			return Entry();
+		}
 
-	for (Move& move : possible_moves) {
-		ChocolateBar test_bar = bar;
+		++hit_count;
 
-		test_bar.MakeMove(move);
+		return *test_entry;
+	}
 
-		float score = Evaluate(test_bar, total_searched, table);
+	// Delete copy operators
+	TranspositionTable(const TranspositionTable&) = delete;
+	TranspositionTable& operator=(const TranspositionTable&) = delete;
+};
 
-		if (score > best_move_score) {
-			best_move_score = score;
-			best_move = &move;
+enum REPLACEMENT_SCHEME {
+	REPLACE_ALWAYS,				// New entry always goes in, over a slot picked by its key
+	REPLACE_WORK_PREFERRED,		// Keep whichever entries took the most searching to find
+	REPLACE_TWO_TIER			// Half the bucket is work-preferred, the other half always-replace
+};
 
-			if (move_score != nullptr) { *move_score = best_move_score; }
-		}
+// Same interface as TranspositionTable, but each 64 byte bucket is exactly one cache line of 8 compressed entries,
+// so a lookup costs at most one cache miss, and a store only ever looks inside its own bucket
+// Entries keep the top 32 bits of the mixed hash to verify against, and scores are only ever win/loss
+struct BucketedTranspositionTable {
+	typedef TranspositionTable::Entry Entry;
 
-		// This move will lead to a guaranteed win, so don't process any more
-		if (score == 1.0f) {
-			Log("Found guaranteed win");
+	struct PackedEntry {
+		static const uint8_t VALID = 1 << 7;
 
-			break;
-		}
-	}
+		uint32_t tag = 0;
+		uint16_t work = 0;
+		int8_t score = 0;
+		uint8_t flags = 0; // VALID | bound
 
-	if (best_move == nullptr) {
-		Log("ERROR! No AI move found!");
+		inline bool isValid() const { return flags & VALID; }
+		inline Entry::Bound getBound() const { return (Entry::Bound)(flags & ~VALID); }
+	};
 
-		return Move(Move::VERTICAL, 0);
-	}
-	else {
-		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+	static const std::size_t ENTRIES_PER_BUCKET = 8;
+	// In two tier mode, slots below this are work-preferred and the rest always-replace
+	static const std::size_t TWO_TIER_SPLIT = ENTRIES_PER_BUCKET / 2;
 
-		float elapsed_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+	struct alignas(64) Bucket {
+		std::array<PackedEntry, ENTRIES_PER_BUCKET> entries;
+	};
 
-		Log("Searched {} positions in {}ms", total_searched, elapsed_time / 1000.0f);
+	static_assert(sizeof(PackedEntry) == 8, "Packed entries must fit 8 to a cache line");
+	static_assert(sizeof(Bucket) == 64, "Buckets must be exactly one cache line");
+
+	std::size_t bucket_count;
+	std::size_t table_size; // MAX SIZE, in entries
+	REPLACEMENT_SCHEME scheme;
+	Bucket* data;
+
+	// Lookups made, and how many of them found the position
+	std::size_t lookup_count = 0;
+	std::size_t hit_count = 0;
+	// Stores that overwrote a different position, and stores that weren't worth keeping
+	std::size_t collision_count = 0;
+	std::size_t insert_failure_count = 0;
+
+	// table_size in entries, rounded up to a power of two number of buckets
+	BucketedTranspositionTable(std::size_t table_size, REPLACEMENT_SCHEME scheme = REPLACE_TWO_TIER)
+		: bucket_count(std::bit_ceil(std::max<std::size_t>(1, table_size / ENTRIES_PER_BUCKET))),
+		table_size(bucket_count * ENTRIES_PER_BUCKET), scheme(scheme)
+	{
+		data = new Bucket[bucket_count];
 
-		return *best_move;
+		Reset();
 	}
-}
+
+	~BucketedTranspositionTable()
+	{
+		delete[] data;
+	}
+
+	Bucket& GetBucket(hash_t mixed_hash) {
+		return data[mixed_hash & (bucket_count - 1)];
+	}
+
+	static uint32_t GetTag(hash_t mixed_hash) {
+		return (uint32_t)(mixed_hash >> 32);
+	}
+
+	void Reset() {
+		std::fill_n(data, bucket_count, Bucket());
+	}
+
+	// Slot an always-replace store goes in, spread by key so one bucket doesn't thrash a single slot
+	static std::size_t GetAlwaysReplaceSlot(uint32_t tag, std::size_t first, std::size_t last) {
+		return first + tag % (last - first);
+	}
+
+	// Cheapest entry to lose in [first, last), empty slots are free
+	static std::size_t GetLeastWorkSlot(const Bucket& bucket, std::size_t first, std::size_t last) {
+		std::size_t slot = first;
+
+		for (std::size_t i = first; i < last; i++) {
+			if (!bucket.entries[i].isValid()) {
+				return i;
+			}
+
+			if (bucket.entries[i].work < bucket.entries[slot].work) {
+				slot = i;
+			}
+		}
+
+		return slot;
+	}
+
+	Entry AddEntry(hash_t position_hash, float score, Entry::Bound bound = Entry::EXACT, uint16_t work = 0) {
+		hash_t mixed_hash = MixHash(position_hash);
+		Bucket& bucket = GetBucket(mixed_hash);
+		uint32_t tag = GetTag(mixed_hash);
+
+		PackedEntry* pending_entry = nullptr;
+
+		// Already stored, update in place
+		for (PackedEntry& entry : bucket.entries) {
+			if (entry.isValid() && entry.tag == tag) {
+				pending_entry = &entry;
+
+				break;
+			}
+		}
+
+		if (pending_entry == nullptr) {
+			std::size_t slot = 0;
+
+			switch (scheme) {
+			case REPLACE_ALWAYS:
+				slot = GetLeastWorkSlot(bucket, 0, ENTRIES_PER_BUCKET);
+
+				// No empty slot, so the key decides who goes
+				if (bucket.entries[slot].isValid()) {
+					slot = GetAlwaysReplaceSlot(tag, 0, ENTRIES_PER_BUCKET);
+				}
+
+				break;
+			case REPLACE_WORK_PREFERRED:
+				slot = GetLeastWorkSlot(bucket, 0, ENTRIES_PER_BUCKET);
+
+				if (bucket.entries[slot].isValid() && bucket.entries[slot].work > work) {
+					++insert_failure_count;
+
+					return Entry();
+				}
+
+				break;
+			case REPLACE_TWO_TIER:
+				slot = GetLeastWorkSlot(bucket, 0, TWO_TIER_SPLIT);
+
+				// Not worth a work-preferred slot, so it goes in the always-replace half instead
+				if (bucket.entries[slot].isValid() && bucket.entries[slot].work > work) {
+					slot = GetLeastWorkSlot(bucket, TWO_TIER_SPLIT, ENTRIES_PER_BUCKET);
+
+					if (bucket.entries[slot].isValid()) {
+						slot = GetAlwaysReplaceSlot(tag, TWO_TIER_SPLIT, ENTRIES_PER_BUCKET);
+					}
+				}
+
+				break;
+			}
+
+			pending_entry = &bucket.entries[slot];
+
+			if (pending_entry->isValid()) {
+				++collision_count;
+			}
+		}
+
+		// Updating our own entry keeps the most work that's gone into it
+		uint16_t previous_work = pending_entry->isValid() && pending_entry->tag == tag ? pending_entry->work : 0;
+
+		pending_entry->tag = tag;
+		pending_entry->work = std::max(work, previous_work);
+		pending_entry->score = (int8_t)score;
+		pending_entry->flags = PackedEntry::VALID | (uint8_t)bound;
+
+		Entry entry;
+		entry.position_hash = position_hash;
+		entry.score = score;
+		entry.bound = bound;
+
+		return entry;
+	}
+
+	Entry Lookup(hash_t position_hash) {
+		++lookup_count;
+
+		hash_t mixed_hash = MixHash(position_hash);
+		Bucket& bucket = GetBucket(mixed_hash);
+		uint32_t tag = GetTag(mixed_hash);
+
+		for (const PackedEntry& packed_entry : bucket.entries) {
+			if (packed_entry.isValid() && packed_entry.tag == tag) {
+				++hit_count;
+
+				Entry entry;
+				entry.position_hash = position_hash;
+				entry.score = packed_entry.score;
+				entry.bound = packed_entry.getBound();
+
+				return entry;
+			}
+		}
+
+		return Entry();
+	}
+
+	// Delete copy operators
+	BucketedTranspositionTable(const BucketedTranspositionTable&) = delete;
+	BucketedTranspositionTable& operator=(const BucketedTranspositionTable&) = delete;
+};
+
+// Same interface as TranspositionTable, but only keeps what a win/loss search needs: 2 bits per position
+// Bars up to max_rows x max_columns are direct-indexed, so their key costs nothing to store,
+// anything bigger goes in a hashed overflow of 32 bit slots holding a 30 bit verification tag
+// Bounds that don't settle win or loss (a loss that's only a lower bound) aren't worth keeping, so aren't stored
+struct CompactTranspositionTable {
+	typedef TranspositionTable::Entry Entry;
+
+	enum Result : uint8_t {
+		UNKNOWN = 0,
+		WIN = 1,
+		LOSS = 2
+	};
+
+	static const int TAG_SHIFT = 2;
+
+	bar_t max_rows;
+	bar_t max_columns;
+	std::vector<uint64_t> direct; // 32 results per word
+	std::vector<uint32_t> overflow; // tag << TAG_SHIFT | result
+	std::size_t table_size; // MAX SIZE, direct positions plus overflow slots
+
+	// Lookups made, and how many of them found the position
+	std::size_t lookup_count = 0;
+	std::size_t hit_count = 0;
+	// Overflow stores that overwrote a different position
+	std::size_t collision_count = 0;
+
+	CompactTranspositionTable(bar_t max_rows, bar_t max_columns, std::size_t overflow_size = 1 << 16)
+		: max_rows(max_rows), max_columns(max_columns),
+		direct((ChocolateBar::DenseIndexCount(max_rows, max_columns) + 31) / 32, 0),
+		overflow(std::bit_ceil(overflow_size), 0)
+	{
+		table_size = ChocolateBar::DenseIndexCount(max_rows, max_columns) + overflow.size();
+	}
+
+	void Reset() {
+		std::fill(direct.begin(), direct.end(), 0);
+		std::fill(overflow.begin(), overflow.end(), 0);
+	}
+
+	static Result ToResult(float score, Entry::Bound bound) {
+		if (score >= 1.0f && bound != Entry::UPPER) { return WIN; }
+		if (score <= -1.0f && bound != Entry::LOWER) { return LOSS; }
+
+		return UNKNOWN;
+	}
+
+	bool IsDirect(const ChocolateBar& bar) const {
+		return bar.rows <= max_rows && bar.columns <= max_columns;
+	}
+
+	Result Load(hash_t position_hash) const {
+		ChocolateBar bar = ChocolateBar::FromPositionHash(position_hash);
+
+		if (IsDirect(bar)) {
+			std::size_t index = bar.DenseIndex(max_rows, max_columns);
+
+			return (Result)((direct[index / 32] >> (index % 32 * 2)) & 3);
+		}
+
+		hash_t mixed_hash = MixHash(position_hash);
+		uint32_t slot = overflow[mixed_hash & (overflow.size() - 1)];
+
+		// Tag from the top bits, the bottom bits already picked the slot
+		if ((slot >> TAG_SHIFT) != (uint32_t)(mixed_hash >> (64 - 32 + TAG_SHIFT))) {
+			return UNKNOWN;
+		}
+
+		return (Result)(slot & 3);
+	}
+
+	void Store(hash_t position_hash, Result result) {
+		ChocolateBar bar = ChocolateBar::FromPositionHash(position_hash);
+
+		if (IsDirect(bar)) {
+			std::size_t index = bar.DenseIndex(max_rows, max_columns);
+			uint64_t& word = direct[index / 32];
+
+			word = (word & ~((uint64_t)3 << (index % 32 * 2))) | ((uint64_t)result << (index % 32 * 2));
+
+			return;
+		}
+
+		// Always replace, losing an entry only costs a re-search
+		hash_t mixed_hash = MixHash(position_hash);
+		uint32_t tag = (uint32_t)(mixed_hash >> (64 - 32 + TAG_SHIFT));
+		uint32_t& slot = overflow[mixed_hash & (overflow.size() - 1)];
+
+		if (slot != 0 && (slot >> TAG_SHIFT) != tag) {
+			++collision_count;
+		}
+
+		slot = (tag << TAG_SHIFT) | result;
+	}
+
+	// work is only used by tables with a replacement scheme
+	Entry AddEntry(hash_t position_hash, float score, Entry::Bound bound = Entry::EXACT, [[maybe_unused]] uint16_t work = 0) {
+		Result result = ToResult(score, bound);
+
+		if (result == UNKNOWN) {
+			return Entry();
+		}
+
+		Store(position_hash, result);
+
+		Entry entry;
+		entry.position_hash = position_hash;
+		entry.score = score;
+		entry.bound = Entry::EXACT;
+
+		return entry;
+	}
+
+	Entry Lookup(hash_t position_hash) {
+		++lookup_count;
+
+		Result result = Load(position_hash);
+
+		if (result == UNKNOWN) {
+			return Entry();
+		}
+
+		++hit_count;
+
+		Entry entry;
+		entry.position_hash = position_hash;
+		entry.score = result == WIN ? 1.0f : -1.0f;
+		entry.bound = Entry::EXACT;
+
+		return entry;
+	}
+
+	// Delete copy operators
+	CompactTranspositionTable(const CompactTranspositionTable&) = delete;
+	CompactTranspositionTable& operator=(const CompactTranspositionTable&) = delete;
+};
+
+// Same interface as TranspositionTable, but safe to share between search threads
+// Uses lockless hashing: each slot stores (hash ^ data, data) as two independent atomic words,
+// a torn write from a racing thread fails the xor check and just reads as a miss
+struct ConcurrentTranspositionTable {
+	typedef std::size_t index_t;
+	typedef TranspositionTable::Entry Entry;
+
+	struct Slot {
+		std::atomic<hash_t> hash_xor_data;
+		std::atomic<uint64_t> data;
+	};
+
+	std::size_t table_size; // MAX SIZE
+	std::atomic<std::size_t> current_size = 0; // ACTUAL SIZE
+	Slot* data;
+
+	// Stores that overwrote a different position, rare enough to count without threads fighting over it
+	std::atomic<std::size_t> collision_count = 0;
+
+	// Rounded up to a power of two so indexing is a mask
+	ConcurrentTranspositionTable(std::size_t table_size)
+		: table_size(std::bit_ceil(table_size))
+	{
+		data = new Slot[this->table_size];
+
+		Reset();
+	}
+
+	~ConcurrentTranspositionTable()
+	{
+		delete[] data;
+	}
+
+	// Score bits in the low word, bound and work in the high word
+	static uint64_t PackData(float score, Entry::Bound bound, uint16_t work = 0) {
+		return (uint64_t)std::bit_cast<uint32_t>(score) | ((uint64_t)bound << 32) | ((uint64_t)work << 48);
+	}
+
+	static uint16_t UnpackWork(uint64_t packed) {
+		return (uint16_t)(packed >> 48);
+	}
+
+	static Entry UnpackEntry(hash_t position_hash, uint64_t packed) {
+		Entry entry;
+
+		entry.position_hash = position_hash;
+		entry.score = std::bit_cast<float>((uint32_t)packed);
+		entry.bound = (Entry::Bound)((packed >> 32) & 0xff);
+
+		return entry;
+	}
+
+	index_t GetIndex(hash_t position_hash) {
+		return MixHash(position_hash) & (table_size - 1);
+	}
+
+	// Reads the hash stored in a slot, a torn slot gives a hash that won't match anything
+	hash_t LoadHash(const Slot& slot, uint64_t& packed) {
+		packed = slot.data.load(std::memory_order_relaxed);
+
+		return slot.hash_xor_data.load(std::memory_order_relaxed) ^ packed;
+	}
+
+	// Not safe to call while other threads are searching
+	void Reset() {
+		uint64_t empty_data = PackData(0.0f, Entry::EXACT);
+
+		for (std::size_t i = 0; i < table_size; i++) {
+			data[i].data.store(empty_data, std::memory_order_relaxed);
+			data[i].hash_xor_data.store(Entry::INVALID_HASH ^ empty_data, std::memory_order_relaxed);
+		}
+
+		current_size = 0;
+	}
+
+	void Store(Slot& slot, hash_t position_hash, uint64_t new_data) {
+		slot.data.store(new_data, std::memory_order_relaxed);
+		slot.hash_xor_data.store(position_hash ^ new_data, std::memory_order_relaxed);
+	}
+
+	// work decides what's kept once the table is full
+	Entry AddEntry(hash_t position_hash, float score, Entry::Bound bound = Entry::EXACT, uint16_t work = 0) {
+		index_t home_index = GetIndex(position_hash);
+		uint64_t new_data = PackData(score, bound, work);
+
+		static const int MAX_ATTEMPTS = 100;
+
+		// Once full there are no empty slots to find, so don't look for one
+		if (current_size.load(std::memory_order_relaxed) < table_size) {
+			index_t index = home_index;
+
+			for (int attempts = 0; attempts < MAX_ATTEMPTS; attempts++) {
+				Slot& slot = data[index];
+
+				uint64_t packed;
+				hash_t stored_hash = LoadHash(slot, packed);
+
+				// Either claim an empty slot, or overwrite our own (possibly with a tighter bound)
+				if (stored_hash == Entry::INVALID_HASH || stored_hash == position_hash) {
+					Store(slot, position_hash, new_data);
+
+					if (stored_hash == Entry::INVALID_HASH) {
+						current_size.fetch_add(1, std::memory_order_relaxed);
+					}
+
+					return UnpackEntry(position_hash, new_data);
+				}
+
+				index = (index + 1) & (table_size - 1);
+			}
+		}
+
+		// Full, or too crowded to probe well, so replace something near our home slot, two-tier style:
+		// the home slot keeps whichever entry took the most work, the slot after it takes anything
+		// Slots are never emptied, so every other probe chain stays intact, and Lookup reaches both first
+		Slot* replaced = &data[home_index];
+
+		uint64_t packed;
+		hash_t stored_hash = LoadHash(*replaced, packed);
+
+		if (stored_hash != position_hash && UnpackWork(packed) > work) {
+			replaced = &data[(home_index + 1) & (table_size - 1)];
+			stored_hash = LoadHash(*replaced, packed);
+		}
+
+		if (stored_hash != position_hash) {
+			collision_count.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		Store(*replaced, position_hash, new_data);
+
+		return UnpackEntry(position_hash, new_data);
+	}
+
+	Entry Lookup(hash_t position_hash) {
+		index_t index = GetIndex(position_hash);
+
+		static const int MAX_ATTEMPTS = 100;
+
+		for (int attempts = 0; attempts < MAX_ATTEMPTS; attempts++) {
+			uint64_t packed;
+			hash_t stored_hash = LoadHash(data[index], packed);
+
+			if (stored_hash == position_hash) {
+				return UnpackEntry(position_hash, packed);
+			}
+
+			// We found an empty entry
+			if (stored_hash == Entry::INVALID_HASH) {
+				return Entry();
+			}
+
+			index = (index + 1) & (table_size - 1);
+		}
+
+		return Entry();
+	}
+
+	// Delete copy operators
+	ConcurrentTranspositionTable(const ConcurrentTranspositionTable&) = delete;
+	ConcurrentTranspositionTable& operator=(const ConcurrentTranspositionTable&) = delete;
+};
+
+// Proof and disproof numbers of positions a proof-number search has expanded but not settled
+// Settled positions go in the search's ordinary table instead, so this only ever holds estimates,
+// and losing one just means the position starts again from its initial numbers. Direct-mapped, always replacing
+struct ProofNumberTable {
+	typedef uint32_t pn_t;
+
+	// Proof number of a position that can't be proven, or disproof number of one that can't be disproven
+	static const pn_t PN_INFINITY = UINT32_MAX;
+	static const std::size_t DEFAULT_TABLE_SIZE = 1 << 16;
+
+	struct Entry {
+		hash_t position_hash = TranspositionTable::Entry::INVALID_HASH;
+		pn_t proof = 1;
+		pn_t disproof = 1;
+
+		inline bool isInvalid() const { return position_hash == TranspositionTable::Entry::INVALID_HASH; }
+	};
+
+	std::size_t table_size; // MAX SIZE
+	std::vector<Entry> data;
+
+	// Lookups made, and how many of them found the position
+	std::size_t lookup_count = 0;
+	std::size_t hit_count = 0;
+	// Stores that overwrote a different position
+	std::size_t collision_count = 0;
+
+	// Rounded up to a power of two so indexing is a mask
+	ProofNumberTable(std::size_t table_size = DEFAULT_TABLE_SIZE)
+		: table_size(std::bit_ceil(table_size)), data(this->table_size) {}
+
+	void Reset() {
+		std::fill(data.begin(), data.end(), Entry());
+	}
+
+	void Store(hash_t position_hash, pn_t proof, pn_t disproof) {
+		Entry& entry = data[MixHash(position_hash) & (table_size - 1)];
+
+		if (!entry.isInvalid() && entry.position_hash != position_hash) {
+			++collision_count;
+		}
+
+		entry.position_hash = position_hash;
+		entry.proof = proof;
+		entry.disproof = disproof;
+	}
+
+	// Numbers for a position never stored are both 1, as for any unexpanded position
+	Entry Lookup(hash_t position_hash) {
+		++lookup_count;
+
+		const Entry& entry = data[MixHash(position_hash) & (table_size - 1)];
+
+		if (entry.position_hash != position_hash) {
+			return Entry();
+		}
+
+		++hit_count;
+
+		return entry;
+	}
+
+	// Delete copy operators
+	ProofNumberTable(const ProofNumberTable&) = delete;
+	ProofNumberTable& operator=(const ProofNumberTable&) = delete;
+};
+
+// Read-only view of a whole file mapped into memory
+struct MappedFile {
+	const void* data = nullptr;
+	std::size_t size = 0;
+
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = nullptr;
+#else
+	int file = -1;
+#endif
+
+	MappedFile() = default;
+
+	~MappedFile()
+	{
+		Close();
+	}
+
+	bool Open(const std::string& path) {
+		Close();
+
+#ifdef _WIN32
+		file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+		if (file == INVALID_HANDLE_VALUE) { return false; }
+
+		LARGE_INTEGER file_size;
+
+		if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) { Close(); return false; }
+
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+		if (mapping == nullptr) { Close(); return false; }
+
+		data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		size = (std::size_t)file_size.QuadPart;
+#else
+		file = open(path.c_str(), O_RDONLY);
+
+		if (file == -1) { return false; }
+
+		struct stat file_stat;
+
+		if (fstat(file, &file_stat) != 0 || file_stat.st_size == 0) { Close(); return false; }
+
+		void* view = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_SHARED, file, 0);
+
+		data = view == MAP_FAILED ? nullptr : view;
+		size = file_stat.st_size;
+#endif
+
+		if (data == nullptr) { Close(); return false; }
+
+		return true;
+	}
+
+	void Close() {
+#ifdef _WIN32
+		if (data != nullptr) { UnmapViewOfFile(data); }
+		if (mapping != nullptr) { CloseHandle(mapping); }
+		if (file != INVALID_HANDLE_VALUE) { CloseHandle(file); }
+
+		mapping = nullptr;
+		file = INVALID_HANDLE_VALUE;
+#else
+		if (data != nullptr) { munmap(const_cast<void*>(data), size); }
+		if (file != -1) { close(file); }
+
+		file = -1;
+#endif
+
+		data = nullptr;
+		size = 0;
+	}
+
+	// Delete copy operators
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+};
+
+// Win/loss for every bar up to max_rows x max_columns, one bit per position, solved bottom-up
+// Every move shrinks rows or columns, so solving in order of increasing size means every child
+// is already in the table when its parent is reached, with no recursion or hashing involved
+// Mirror images share a score, so only positions with the poison in the nearer half of each axis are stored
+struct Tablebase {
+	// On disk: this header, then the bits exactly as they're laid out in memory
+	struct FileHeader {
+		static const uint32_t MAGIC = 0x42544244; // "DBTB"
+		static const uint32_t VERSION = 1;
+
+		uint32_t magic = MAGIC;
+		uint32_t version = VERSION;
+		uint16_t max_rows = 0;
+		uint16_t max_columns = 0;
+		uint32_t reserved = 0;
+		uint64_t word_count = 0;
+	};
+
+	bar_t max_rows = 0;
+	bar_t max_columns = 0;
+
+	// 1 if the player to move in that position wins
+	// Points into owned_bits when generated, or straight into the file when loaded
+	const uint64_t* bits = nullptr;
+	std::size_t word_count = 0;
+
+	std::vector<uint64_t> owned_bits;
+	MappedFile mapped_file;
+
+	Tablebase() = default;
+
+	Tablebase(bar_t max_rows, bar_t max_columns)
+		: max_rows(max_rows), max_columns(max_columns),
+		word_count((ChocolateBar::DenseIndexCount(max_rows, max_columns) + 63) / 64),
+		owned_bits(word_count, 0)
+	{
+		bits = owned_bits.data();
+	}
+
+	bool Contains(const ChocolateBar& bar) const {
+		return bar.rows <= max_rows && bar.columns <= max_columns;
+	}
+
+	std::size_t GetIndex(const ChocolateBar& bar) const {
+		return bar.DenseIndex(max_rows, max_columns);
+	}
+
+	bool IsWin(const ChocolateBar& bar) const {
+		std::size_t index = GetIndex(bar);
+
+		return (bits[index / 64] >> (index % 64)) & 1;
+	}
+
+	void SetWin(const ChocolateBar& bar) {
+		std::size_t index = GetIndex(bar);
+
+		owned_bits[index / 64] |= (uint64_t)1 << (index % 64);
+	}
+
+	void Generate() {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		for (int rows = 1; rows <= max_rows; rows++) {
+			for (int columns = 1; columns <= max_columns; columns++) {
+				for (int prow = 0; prow < (rows + 1) / 2; prow++) {
+					for (int pcolumn = 0; pcolumn < (columns + 1) / 2; pcolumn++) {
+						ChocolateBar bar(columns, rows, pcolumn, prow);
+
+						// Winning if any move leaves the opponent in a lost position
+						for (const Move& move : bar.GetValidMoves()) {
+							ChocolateBar test_bar = bar;
+							test_bar.MakeMove(move);
+
+							if (!IsWin(test_bar)) {
+								SetWin(bar);
+
+								break;
+							}
+						}
+					}
+				}
+			}
+		}
+
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+		float elapsed_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+		LogInfo("Generated {}x{} tablebase ({} bytes) in {}ms", max_rows, max_columns, word_count * sizeof(uint64_t), elapsed_time / 1000.0f);
+	}
+
+	bool Save(const std::string& path) const {
+		std::ofstream file(path, std::ios::binary);
+
+		if (!file) {
+			return false;
+		}
+
+		FileHeader header;
+		header.max_rows = max_rows;
+		header.max_columns = max_columns;
+		header.word_count = word_count;
+
+		file.write((const char*)&header, sizeof(header));
+		file.write((const char*)bits, word_count * sizeof(uint64_t));
+
+		return (bool)file;
+	}
+
+	// Maps the file and reads bits straight out of it, so nothing is parsed or copied
+	bool Load(const std::string& path) {
+		if (!mapped_file.Open(path)) {
+			return false;
+		}
+
+		if (mapped_file.size < sizeof(FileHeader)) {
+			LogWarn("Tablebase {} is truncated", path);
+
+			mapped_file.Close();
+
+			return false;
+		}
+
+		const FileHeader* header = (const FileHeader*)mapped_file.data;
+
+		if (header->magic != FileHeader::MAGIC || header->version != FileHeader::VERSION
+			|| header->word_count != (ChocolateBar::DenseIndexCount(header->max_rows, header->max_columns) + 63) / 64
+			|| mapped_file.size != sizeof(FileHeader) + header->word_count * sizeof(uint64_t))
+		{
+			LogWarn("Tablebase {} has an unknown version or is corrupt", path);
+
+			mapped_file.Close();
+
+			return false;
+		}
+
+		max_rows = header->max_rows;
+		max_columns = header->max_columns;
+		word_count = header->word_count;
+		bits = (const uint64_t*)(header + 1);
+
+		owned_bits.clear();
+
+		return true;
+	}
+
+	// Uses the tablebase at path if it covers the requested size, otherwise solves it and saves it there
+	// Returns true once the tablebase is usable, even if it couldn't be saved
+	bool LoadOrGenerate(const std::string& path, bar_t rows, bar_t columns) {
+		if (Load(path) && max_rows >= rows && max_columns >= columns) {
+			LogInfo("Loaded {}x{} tablebase from {}", max_rows, max_columns, path);
+
+			return true;
+		}
+
+		mapped_file.Close();
+
+		max_rows = rows;
+		max_columns = columns;
+		word_count = (ChocolateBar::DenseIndexCount(max_rows, max_columns) + 63) / 64;
+		owned_bits.assign(word_count, 0);
+		bits = owned_bits.data();
+
+		Generate();
+
+		// Still solved, only the next run has to solve it again
+		if (!Save(path)) {
+			LogWarn("Couldn't save tablebase to {}, it will be generated again next run", path);
+		}
+
+		return true;
+	}
+
+	// Same perspective as Evaluate: 1 if the player who moved into this position wins
+	float Evaluate(const ChocolateBar& bar) const {
+		return IsWin(bar) ? -1.0f : 1.0f;
+	}
+
+	Move GetMove(const ChocolateBar& bar, float* move_score = nullptr) const {
+		MoveRange possible_moves = bar.GetValidMoves();
+
+		if (move_score != nullptr) {
+			*move_score = -1.0f;
+		}
+
+		if (possible_moves.empty()) {
+			LogError("No AI move found!");
+
+			return Move(Move::VERTICAL, 0);
+		}
+
+		for (const Move& move : possible_moves) {
+			ChocolateBar test_bar = bar;
+			test_bar.MakeMove(move);
+
+			if (!IsWin(test_bar)) {
+				if (move_score != nullptr) { *move_score = 1.0f; }
+
+				return move;
+			}
+		}
+
+		// Lost anyway, so any move will do
+		return possible_moves[0];
+	}
+
+	// Delete copy operators
+	Tablebase(const Tablebase&) = delete;
+	Tablebase& operator=(const Tablebase&) = delete;
+};
+
+// Solved positions loaded at startup, consulted before searching any bar it covers
+static const Tablebase* LOADED_TABLEBASE = nullptr;
+
+std::string ReprMove(const Move& move) {
+	std::stringstream ss;
+
+	if (move.dir == Move::Direction::HORIZONTAL) {
+		ss << "Horizontal split at: ";
+	}
+	else {
+		ss << "Vertical split at: ";
+	}
+
+	ss << move.location;
+
+	return ss.str();
+}
+
+enum SEARCH_PHASE {
+	PHASE_SEARCH,	// Searching positions
+	PHASE_SOLVE,	// Answered straight from the tablebase or the nim sum
+	PHASE_OUTPUT,	// Printing maps and progress
+	PHASE_COUNT
+};
+
+static const std::array<const char*, PHASE_COUNT> PHASE_NAMES = { "search", "solve", "output" };
+
+// Counters a table keeps over its whole life, any a table doesn't keep read as 0
+struct TableCounters {
+	uint64_t collisions = 0;
+	uint64_t insert_failures = 0;
+	uint64_t evictions = 0;
+	uint64_t max_probe_length = 0;
+
+	template <typename Table>
+	static TableCounters Read(const Table& table) {
+		TableCounters counters;
+
+		if constexpr (requires { table.collision_count; }) { counters.collisions = table.collision_count; }
+		if constexpr (requires { table.insert_failure_count; }) { counters.insert_failures = table.insert_failure_count; }
+		if constexpr (requires { table.eviction_count; }) { counters.evictions = table.eviction_count; }
+		if constexpr (requires { table.max_probe_length; }) { counters.max_probe_length = table.max_probe_length; }
+
+		return counters;
+	}
+};
+
+// Where a search, or a whole sweep of them, spent its effort
+// 64 bit throughout, a full sweep easily overflows an int
+struct SearchStats {
+	uint64_t nodes = 0;				// Positions searched, including where each search started
+	uint64_t pruned = 0;			// Moves skipped by cutoffs
+	uint64_t cutoffs = 0;			// Positions that stopped early on a cutoff
+	uint64_t max_depth = 0;			// Most frames on the stack at once
+
+	uint64_t table_probes = 0;
+	uint64_t table_hits = 0;		// Probes that found a score the search could use
+	uint64_t table_misses = 0;
+	uint64_t table_collisions = 0;	// Other positions stepped past or overwritten
+	uint64_t table_insert_failures = 0;
+	uint64_t table_evictions = 0;	// Entries overwritten because the table was at its memory cap
+	uint64_t max_probe_length = 0;	// Longest the table has ever probed, not just during this search
+
+	std::array<std::chrono::nanoseconds, PHASE_COUNT> phase_time = {};
+
+	SearchStats& operator+=(const SearchStats& other) {
+		nodes += other.nodes;
+		pruned += other.pruned;
+		cutoffs += other.cutoffs;
+		max_depth = std::max(max_depth, other.max_depth);
+
+		table_probes += other.table_probes;
+		table_hits += other.table_hits;
+		table_misses += other.table_misses;
+		table_collisions += other.table_collisions;
+		table_insert_failures += other.table_insert_failures;
+		table_evictions += other.table_evictions;
+		max_probe_length = std::max(max_probe_length, other.max_probe_length);
+
+		for (int phase = 0; phase < PHASE_COUNT; phase++) {
+			phase_time[phase] += other.phase_time[phase];
+		}
+
+		return *this;
+	}
+
+	// Adds what a table did between two reads of its counters
+	void AddTableCounters(const TableCounters& before, const TableCounters& after) {
+		table_collisions += after.collisions - before.collisions;
+		table_insert_failures += after.insert_failures - before.insert_failures;
+		table_evictions += after.evictions - before.evictions;
+		max_probe_length = std::max(max_probe_length, after.max_probe_length);
+	}
+
+	void Log(const std::string& label) const {
+		LogInfo("{}: {} nodes, {} pruned moves, {} cutoffs, max depth {}", label, nodes, pruned, cutoffs, max_depth);
+		LogInfo("{}: {} table probes, {} hits, {} misses, {} collisions, {} failed inserts, {} evictions, longest probe {}",
+			label, table_probes, table_hits, table_misses, table_collisions, table_insert_failures, table_evictions, max_probe_length);
+
+		std::string phases;
+
+		for (int phase = 0; phase < PHASE_COUNT; phase++) {
+			phases += std::format("{}{}ms {}", phase > 0 ? ", " : "", phase_time[phase].count() / 1000000.0, PHASE_NAMES[phase]);
+		}
+
+		LogInfo("{}: {}", label, phases);
+	}
+};
+
+// Adds the time until it goes out of scope to one phase of stats, if there are any
+struct PhaseTimer {
+	SearchStats* stats;
+	SEARCH_PHASE phase;
+	std::chrono::steady_clock::time_point start;
+
+	PhaseTimer(SearchStats* stats, SEARCH_PHASE phase)
+		: stats(stats), phase(phase), start(std::chrono::steady_clock::now()) {}
+
+	~PhaseTimer() {
+		if (stats != nullptr) {
+			stats->phase_time[phase] += std::chrono::steady_clock::now() - start;
+		}
+	}
+};
+
+enum MOVE_ORDERING {
+	ORDER_NONE = 0,				// GetValidMoves order
+	ORDER_HASH_MOVE = 1 << 0,	// Best move found the last time this exact position was searched
+	ORDER_BALANCE = 1 << 1,		// Moves leaving the poison closest to equidistant from opposite edges
+	ORDER_ALL = ORDER_HASH_MOVE | ORDER_BALANCE
+};
+
+// What a search has learnt about which moves are strong, kept by the caller across searches like a table
+// Only moves that cost the same to find however many moves a position has are tried first, the rest follow in
+// GetValidMoves order. Killers and history keyed by where a split is were tried, but a location means nothing
+// from one position to the next here, and ranking by them searched more positions and took longer than not ordering
+// Hash moves are keyed by PositionHash rather than TableKey, a move only means the same thing in the same orientation
+struct MoveOrdering {
+	static const std::size_t DEFAULT_HASH_MOVE_SIZE = 1 << 14;
+	// Offset move, hash move and the most balanced split of each axis
+	static const std::size_t MAX_FIRST_MOVES = 4;
+
+	struct HashMove {
+		hash_t position_hash = TranspositionTable::Entry::INVALID_HASH;
+		Move move = Move(Move::HORIZONTAL, 0);
+	};
+
+	int flags;
+
+	std::vector<HashMove> hash_moves;
+
+	MoveOrdering(int flags = ORDER_NONE, std::size_t hash_move_size = DEFAULT_HASH_MOVE_SIZE)
+		: flags(flags),
+		hash_moves(flags & ORDER_HASH_MOVE ? std::bit_ceil(hash_move_size) : 0) {}
+
+	// Index of move in bar's GetValidMoves, or SIZE_MAX if it isn't one of them
+	static std::size_t MoveIndex(const ChocolateBar& bar, const Move& move) {
+		if (move.location < 1) {
+			return SIZE_MAX;
+		}
+
+		if (move.dir == Move::HORIZONTAL && move.location < bar.rows) {
+			return move.location - 1;
+		}
+		else if (move.dir == Move::VERTICAL && move.location < bar.columns) {
+			return (bar.rows - 1) + move.location - 1;
+		}
+
+		return SIZE_MAX;
+	}
+
+	// Most balanced split along one axis, or SIZE_MAX if the axis can't be split
+	// Balanced means the poison as close to equidistant as it gets, found directly rather than by trying each split
+	static std::size_t BalancedMoveIndex(const ChocolateBar& bar, Move::Direction dir, int& imbalance) {
+		int size = dir == Move::VERTICAL ? bar.columns : bar.rows;
+		int poison = dir == Move::VERTICAL ? bar.poison_column : bar.poison_row;
+		int after = size - 1 - poison;
+
+		std::size_t index = SIZE_MAX;
+		imbalance = INT_MAX;
+
+		// Splitting before the poison leaves poison - location before it
+		if (poison >= 1) {
+			int location = std::clamp(poison - after, 1, poison);
+
+			imbalance = std::abs(poison - location - after);
+			index = MoveIndex(bar, Move(dir, (bar_t)location));
+		}
+
+		// Splitting after it leaves location - 1 - poison after it
+		if (after >= 1) {
+			int location = std::clamp(2 * poison + 1, poison + 1, size - 1);
+			int after_imbalance = std::abs(location - 1 - poison - poison);
+
+			if (after_imbalance < imbalance) {
+				imbalance = after_imbalance;
+				index = MoveIndex(bar, Move(dir, (bar_t)location));
+			}
+		}
+
+		return index;
+	}
+
+	// Appends the hash move, then the most balanced split of each axis, that are among bar's moves
+	// and not already in first, returns the new count
+	std::size_t FirstMoves(const ChocolateBar& bar, std::size_t* first, std::size_t count) const {
+		auto Append = [&](std::size_t index) {
+			if (index != SIZE_MAX && std::find(first, first + count, index) == first + count) {
+				first[count++] = index;
+			}
+		};
+
+		if (flags & ORDER_HASH_MOVE) {
+			const HashMove& slot = hash_moves[MixHash(bar.PositionHash()) & (hash_moves.size() - 1)];
+
+			if (slot.position_hash == bar.PositionHash()) {
+				Append(MoveIndex(bar, slot.move));
+			}
+		}
+
+		if (flags & ORDER_BALANCE) {
+			int horizontal_imbalance;
+			int vertical_imbalance;
+
+			std::size_t horizontal = BalancedMoveIndex(bar, Move::HORIZONTAL, horizontal_imbalance);
+			std::size_t vertical = BalancedMoveIndex(bar, Move::VERTICAL, vertical_imbalance);
+
+			if (vertical_imbalance < horizontal_imbalance) {
+				std::swap(horizontal, vertical);
+			}
+
+			Append(horizontal);
+			Append(vertical);
+		}
+
+		return count;
+	}
+
+	// move was the best found in bar, which is in the position it was made from
+	void RecordBest(const ChocolateBar& bar, const Move& move) {
+		if (flags & ORDER_HASH_MOVE) {
+			HashMove& slot = hash_moves[MixHash(bar.PositionHash()) & (hash_moves.size() - 1)];
+
+			slot.position_hash = bar.PositionHash();
+			slot.move = move;
+		}
+	}
+};
+
+// Negamax from the perspective of the player who just moved into this position,
+// so the opponent picks the reply that minimises our score
+// alpha/beta bound the score we care about, anything outside the window is only a bound
+// Each level of the search is a frame in preallocated storage rather than on the call stack,
+// and moves are made and unmade on a single bar, so deep bars can't overflow the stack
+// Run can stop after a number of positions, and carries on from where it left off when called again
+// Positions deeper than max_depth score UNKNOWN_SCORE, which is never stored, so every stored score stays proven
+template <typename Table>
+struct SearchStack {
+	// Between a loss and a win, so a move that might win is still preferred over a known loss
+	static constexpr float UNKNOWN_SCORE = 0.0f;
+
+	struct Frame {
+		MoveRange moves;
+		std::size_t move_index;
+		std::size_t move_offset;
+
+		float alpha;
+		float beta;
+		float min_score;
+
+		// With an ordering, moves tried before the rest: the helper's offset move, the hash move,
+		// and the most balanced split of each axis
+		std::array<std::size_t, MoveOrdering::MAX_FIRST_MOVES> first_moves;
+		std::size_t first_count;
+		// Next move to check once past first_moves, in GetValidMoves order
+		std::size_t scan_index;
+
+		// Move being searched, and what's needed to take it back
+		std::size_t current_move;
+		std::size_t best_move;
+		ChocolateBar::Undo undo;
+		hash_t position_hash;
+		uint64_t searched_before;
+	};
+
+	Table& table;
+
+	ChocolateBar bar;
+	std::vector<Frame> frames;
+	std::size_t depth = 0;
+
+	// Caller's, like the table, so what one search teaches about good moves carries over to the next
+	// Without one, moves are tried in GetValidMoves order
+	MoveOrdering* ordering;
+
+	// Set when a position has been scored and its parent hasn't used the score yet
+	bool returning = false;
+	float result = 0.0f;
+
+	// Totals over every search since construction
+	SearchStats stats;
+
+	// Frames searched below the starting bar before giving up on a position, and whether that happened this search
+	std::size_t max_depth = SIZE_MAX;
+	bool hit_horizon = false;
+
+	// Searches with a different helper_id try moves in a different order,
+	// so threads sharing a table spread out over the tree instead of all solving the same positions
+	std::size_t helper_id = 0;
+
+	SearchStack(Table& table, MoveOrdering* ordering = nullptr)
+		: table(table), bar(1, 1, 0, 0), ordering(ordering) {}
+
+	void Start(const ChocolateBar& start_bar, float alpha = -1.0f, float beta = 1.0f) {
+		bar = start_bar;
+		depth = 0;
+		returning = false;
+		hit_horizon = false;
+
+		// Every move shrinks the bar by at least one row or column, so this is as deep as it gets
+		std::size_t frames_needed = (std::size_t)bar.rows + bar.columns;
+
+		if (frames.size() < frames_needed) {
+			frames.resize(frames_needed, Frame{ MoveRange(1, 1) });
+		}
+
+		++stats.nodes;
+
+		Push(alpha, beta);
+	}
+
+	bool Finished() const {
+		return depth == 0 && returning;
+	}
+
+	// Score of the starting bar, once Finished
+	float Score() const {
+		return result;
+	}
+
+	// Which of a position's moves this search tries first
+	std::size_t GetMoveOffset(const ChocolateBar& position, std::size_t move_count) const {
+		if (helper_id == 0) {
+			return 0;
+		}
+
+		return (std::size_t)(MixHash(position.TableKey() + helper_id) % move_count);
+	}
+
+	// Runs to the end unless stop is set first, returns true if the starting bar was scored
+	// stop is only checked every POSITIONS_PER_CHECK positions, so other threads can cancel a search cheaply
+	bool RunUntilStopped(const std::atomic<bool>& stop) {
+		static const std::size_t POSITIONS_PER_CHECK = 1024;
+
+		while (!Run(POSITIONS_PER_CHECK)) {
+			if (stop.load(std::memory_order_relaxed)) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Searches at most max_positions more positions, returns true once the starting bar is scored
+	bool Run(std::size_t max_positions = SIZE_MAX) {
+		PhaseTimer timer(&stats, PHASE_SEARCH);
+		TableCounters table_before = TableCounters::Read(table);
+
+		std::size_t positions_run = 0;
+
+		while (depth > 0) {
+			Frame& frame = frames[depth - 1];
+
+			float position_score;
+
+			if (returning) {
+				returning = false;
+
+#ifdef __ENABLE_TRANSPOSITIONS
+				if (result != UNKNOWN_SCORE) {
+					// Positions it took to get this score, tells the table how expensive the entry is to lose
+					uint16_t work = (uint16_t)std::min<uint64_t>(stats.nodes - frame.searched_before, 0xffff);
+
+					// Add to lookup table, remembering whether the score was cut off by the window
+					TranspositionTable::Entry::Bound bound = TranspositionTable::Entry::BoundForWindow(result, -frame.beta, -frame.alpha);
+
+					table.AddEntry(frame.position_hash, result, bound, work);
+				}
+#endif
+
+				position_score = -result;
+			}
+			else {
+				// Every move searched without a cutoff
+				if (frame.move_index == frame.moves.size()) {
+					if (ordering != nullptr) {
+						ordering->RecordBest(bar, frame.moves[frame.best_move]);
+					}
+
+					Pop(frame.min_score);
+
+					continue;
+				}
+
+				if (positions_run >= max_positions) {
+					stats.AddTableCounters(table_before, TableCounters::Read(table));
+
+					return false;
+				}
+
+				frame.current_move = NextMoveIndex(frame);
+				frame.undo = bar.MakeMove(frame.moves[frame.current_move]);
+
+				++frame.move_index;
+
+#ifdef __ENABLE_TRANSPOSITIONS
+				frame.position_hash = bar.TableKey();
+				TranspositionTable::Entry entry = table.Lookup(frame.position_hash);
+
+				++stats.table_probes;
+
+				// Means this position has been looked up before, and the stored score is usable in the child's window
+				if (entry.isUsable(-frame.beta, -frame.alpha)) {
+					++stats.table_hits;
+
+					position_score = -entry.score;
+				}
+				else {
+					++stats.table_misses;
+
+					frame.searched_before = stats.nodes;
+
+					++stats.nodes;
+					++positions_run;
+
+					// Get score for this state, from the opponent's perspective
+					Push(-frame.beta, -frame.alpha);
+
+					continue;
+				}
+#else
+				++stats.nodes;
+				++positions_run;
+
+				Push(-frame.beta, -frame.alpha);
+
+				continue;
+#endif
+			}
+
+			bar.UnmakeMove(frame.undo);
+
+			if (position_score < frame.min_score) {
+				frame.min_score = position_score;
+				frame.best_move = frame.current_move;
+			}
+
+			// Opponent has a reply at least as bad for us as a line we already have, so stop looking
+			if (frame.min_score <= frame.alpha) {
+				++stats.cutoffs;
+				stats.pruned += frame.moves.size() - frame.move_index;
+
+				if (ordering != nullptr) {
+					ordering->RecordBest(bar, frame.moves[frame.current_move]);
+				}
+
+				Pop(frame.min_score);
+
+				continue;
+			}
+
+			frame.beta = std::min(frame.beta, frame.min_score);
+		}
+
+		stats.AddTableCounters(table_before, TableCounters::Read(table));
+
+		return true;
+	}
+
+private:
+	// Enter the position bar is in now, scoring it straight away if it's already solved
+	void Push(float alpha, float beta) {
+		if (LOADED_TABLEBASE != nullptr && LOADED_TABLEBASE->Contains(bar)) {
+			result = LOADED_TABLEBASE->Evaluate(bar);
+			returning = true;
+
+			return;
+		}
+
+		MoveRange moves = bar.GetValidMoves();
+
+		// Next person to move loses, so return a score of 1
+		if (moves.empty()) {
+			result = 1.0f;
+			returning = true;
+
+			return;
+		}
+
+		if (depth >= max_depth) {
+			result = UNKNOWN_SCORE;
+			returning = true;
+			hit_horizon = true;
+
+			return;
+		}
+
+		if (depth == frames.size()) {
+			frames.push_back(Frame{ moves });
+		}
+
+		std::size_t move_offset = GetMoveOffset(bar, moves.size());
+
+		Frame& frame = frames[depth];
+		frame = Frame{ moves, 0, move_offset, alpha, beta, FLT_MAX };
+		frame.first_count = 0;
+		frame.scan_index = 0;
+
+		if (ordering != nullptr) {
+			// Helpers still start somewhere different, then follow the ordering
+			if (move_offset != 0) {
+				frame.first_moves[frame.first_count++] = move_offset;
+			}
+
+			frame.first_count = ordering->FirstMoves(bar, frame.first_moves.data(), frame.first_count);
+		}
+
+		++depth;
+
+		stats.max_depth = std::max<uint64_t>(stats.max_depth, depth);
+	}
+
+	// Picks the next move to try, returning its index in the frame's MoveRange
+	std::size_t NextMoveIndex(Frame& frame) {
+		std::size_t move_count = frame.moves.size();
+
+		if (ordering == nullptr) {
+			// Tried in order starting from move_offset, wrapping round
+			std::size_t index = frame.move_index + frame.move_offset;
+
+			return index < move_count ? index : index - move_count;
+		}
+
+		if (frame.move_index < frame.first_count) {
+			return frame.first_moves[frame.move_index];
+		}
+
+		// The rest go in GetValidMoves order, skipping those already tried
+		while (std::find(frame.first_moves.begin(), frame.first_moves.begin() + frame.first_count, frame.scan_index) != frame.first_moves.begin() + frame.first_count) {
+			++frame.scan_index;
+		}
+
+		return frame.scan_index++;
+	}
+
+	void Pop(float score) {
+		--depth;
+
+		result = score;
+		returning = true;
+	}
+};
+
+// ordering, if given, picks which moves to try first, and learns from this search for the next
+template <typename Table>
+float Evaluate(const ChocolateBar& bar, SearchStats& stats, Table& table, float alpha = -1.0f, float beta = 1.0f, MoveOrdering* ordering = nullptr) {
+	SearchStack<Table> search(table, ordering);
+
+	search.Start(bar, alpha, beta);
+	search.Run();
+
+	stats += search.stats;
+
+	return search.Score();
+}
+
+// Depth-first proof-number search (df-pn): every score is a win or a loss, so rather than searching moves in order,
+// always expand the position that does the most towards settling the starting bar
+// A position's proof number is how many positions must still be settled to show the player to move wins, its disproof
+// number how many to show they lose. The player to move wins if any reply loses, and loses only if every reply wins,
+// so a position's proof number is the least disproof number of its replies, and its disproof number the sum of their proof numbers
+// Each frame keeps searching its most-proving reply until its numbers pass the thresholds its parent gave it,
+// which is what lets it run depth first instead of holding the whole tree in memory
+// Settled positions are stored as scores in table, so it can be shared with the other engines, anything else in pn_table
+// Both are the caller's, so what one search expands is still there for the next
+template <typename Table>
+struct ProofNumberSearch {
+	typedef ProofNumberTable::pn_t pn_t;
+
+	static const pn_t PN_INFINITY = ProofNumberTable::PN_INFINITY;
+
+	struct Numbers {
+		pn_t proof;
+		pn_t disproof;
+	};
+
+	struct Frame {
+		MoveRange moves;
+
+		pn_t proof_threshold;
+		pn_t disproof_threshold;
+
+		// Replies' numbers are kept in children, starting here, while this position is being searched
+		std::size_t children_begin;
+		std::size_t child_index;
+
+		// Reply being searched, and what's needed to take it back
+		ChocolateBar::Undo undo;
+		hash_t position_hash;
+		uint64_t searched_before;
+	};
+
+	Table& table;
+	ProofNumberTable& pn_table;
+
+	ChocolateBar bar;
+	std::vector<Frame> frames;
+	std::vector<Numbers> children;
+	std::size_t depth = 0;
+	std::size_t children_used = 0;
+
+	// Numbers of the position just left, for its parent to pick up
+	Numbers result = { 1, 1 };
+
+	// Most-proving reply of the starting bar, a winning one if it's a win
+	std::size_t best_move_index = 0;
+
+	// Totals over every search since construction
+	SearchStats stats;
+
+	ProofNumberSearch(Table& table, ProofNumberTable& pn_table)
+		: table(table), pn_table(pn_table), bar(1, 1, 0, 0) {}
+
+	// Sum of proof numbers, which only reaches infinity if one of them is infinite
+	static pn_t AddNumbers(pn_t a, pn_t b) {
+		if (a == PN_INFINITY || b == PN_INFINITY) {
+			return PN_INFINITY;
+		}
+
+		return (pn_t)std::min<uint64_t>((uint64_t)a + b, PN_INFINITY - 1);
+	}
+
+	// Runs until the starting bar is proven or disproven
+	void Search(const ChocolateBar& start_bar) {
+		PhaseTimer timer(&stats, PHASE_SEARCH);
+		TableCounters table_before = TableCounters::Read(table);
+
+		bar = start_bar;
+		depth = 0;
+		children_used = 0;
+		best_move_index = 0;
+
+		// Every move shrinks the bar by at least one row or column, so this is as deep as it gets
+		std::size_t frames_needed = (std::size_t)bar.rows + bar.columns;
+
+		if (frames.size() < frames_needed) {
+			frames.resize(frames_needed, Frame{ MoveRange(1, 1) });
+		}
+
+		++stats.nodes;
+
+		if (Push(bar.TableKey(), PN_INFINITY, PN_INFINITY)) {
+			while (depth > 0) {
+				Step();
+			}
+		}
+
+		stats.AddTableCounters(table_before, TableCounters::Read(table));
+	}
+
+	// Same perspective as Evaluate: 1 if the player who moved into the starting bar wins
+	float Score() const {
+		return result.disproof == 0 ? 1.0f : -1.0f;
+	}
+
+private:
+	// Numbers of a reply before it's been searched, settled straight away if anything already knows its result
+	Numbers InitialNumbers(const ChocolateBar& position) {
+		if (LOADED_TABLEBASE != nullptr && LOADED_TABLEBASE->Contains(position)) {
+			return LOADED_TABLEBASE->IsWin(position) ? Numbers{ 0, PN_INFINITY } : Numbers{ PN_INFINITY, 0 };
+		}
+
+		// Next person to move loses
+		if (position.rows <= 1 && position.columns <= 1) {
+			return Numbers{ PN_INFINITY, 0 };
+		}
+
+		TranspositionTable::Entry entry = table.Lookup(position.TableKey());
+
+		++stats.table_probes;
+
+		// Only a settled score is any use, whatever bound it was stored with
+		if (entry.isUsable(-1.0f, 1.0f)) {
+			++stats.table_hits;
+
+			return entry.score > 0.0f ? Numbers{ PN_INFINITY, 0 } : Numbers{ 0, PN_INFINITY };
+		}
+
+		++stats.table_misses;
+
+		ProofNumberTable::Entry pn_entry = pn_table.Lookup(position.TableKey());
+
+		// Never expanded: one winning move proves it, but every move has to be refuted to disprove it
+		if (pn_entry.isInvalid()) {
+			return Numbers{ 1, (pn_t)position.GetValidMoves().size() };
+		}
+
+		return Numbers{ pn_entry.proof, pn_entry.disproof };
+	}
+
+	// Enter the position bar is in now, returns false if it was settled without needing a frame
+	bool Push(hash_t position_hash, pn_t proof_threshold, pn_t disproof_threshold) {
+		if (LOADED_TABLEBASE != nullptr && LOADED_TABLEBASE->Contains(bar)) {
+			result = LOADED_TABLEBASE->IsWin(bar) ? Numbers{ 0, PN_INFINITY } : Numbers{ PN_INFINITY, 0 };
+
+			return false;
+		}
+
+		MoveRange moves = bar.GetValidMoves();
+
+		// Next person to move loses
+		if (moves.empty()) {
+			result = Numbers{ PN_INFINITY, 0 };
+
+			return false;
+		}
+
+		if (children.size() < children_used + moves.size()) {
+			children.resize(children_used + moves.size());
+		}
+
+		Frame& frame = frames[depth++];
+		frame = Frame{ moves, proof_threshold, disproof_threshold, children_used, 0 };
+		frame.position_hash = position_hash;
+		frame.searched_before = stats.nodes;
+
+		children_used += moves.size();
+
+		for (std::size_t i = 0; i < moves.size(); i++) {
+			ChocolateBar::Undo undo = bar.MakeMove(moves[i]);
+
+			children[frame.children_begin + i] = InitialNumbers(bar);
+
+			bar.UnmakeMove(undo);
+		}
+
+		stats.max_depth = std::max<uint64_t>(stats.max_depth, depth);
+
+		return true;
+	}
+
+	// Leave the top position, storing its numbers wherever they belong
+	void Pop(const Numbers& numbers) {
+		Frame& frame = frames[depth - 1];
+
+		if (numbers.proof == 0 || numbers.disproof == 0) {
+			// Positions it took to settle, tells the table how expensive the entry is to lose
+			uint16_t work = (uint16_t)std::min<uint64_t>(stats.nodes - frame.searched_before, 0xffff);
+
+			// Scores are for whoever moved in, who wins exactly when the player to move is disproven
+			table.AddEntry(frame.position_hash, numbers.disproof == 0 ? 1.0f : -1.0f, TranspositionTable::Entry::EXACT, work);
+		}
+		else {
+			pn_table.Store(frame.position_hash, numbers.proof, numbers.disproof);
+		}
+
+		children_used = frame.children_begin;
+		--depth;
+
+		result = numbers;
+
+		// Parent picks up where it left off, with this reply's numbers brought up to date
+		if (depth > 0) {
+			Frame& parent = frames[depth - 1];
+
+			bar.UnmakeMove(parent.undo);
+			children[parent.children_begin + parent.child_index] = numbers;
+		}
+	}
+
+	// Searches the top position's most-proving reply, or leaves the position once its thresholds are passed
+	void Step() {
+		Frame& frame = frames[depth - 1];
+		Numbers* replies = &children[frame.children_begin];
+
+		Numbers numbers = { PN_INFINITY, 0 };
+
+		// Most-proving reply is the one with the least disproof number, the runner up bounds how long to stay on it
+		std::size_t best_index = 0;
+		pn_t second_disproof = PN_INFINITY;
+
+		for (std::size_t i = 0; i < frame.moves.size(); i++) {
+			if (replies[i].disproof < numbers.proof) {
+				second_disproof = numbers.proof;
+				numbers.proof = replies[i].disproof;
+				best_index = i;
+			}
+			else if (replies[i].disproof < second_disproof) {
+				second_disproof = replies[i].disproof;
+			}
+
+			numbers.disproof = AddNumbers(numbers.disproof, replies[i].proof);
+		}
+
+		if (depth == 1) {
+			best_move_index = best_index;
+		}
+
+		if (numbers.proof >= frame.proof_threshold || numbers.disproof >= frame.disproof_threshold) {
+			Pop(numbers);
+
+			return;
+		}
+
+		// Reply may stay until either it stops being the most proving, or this position's disproof number passes its threshold
+		pn_t reply_proof_threshold = frame.disproof_threshold == PN_INFINITY
+			? PN_INFINITY
+			: frame.disproof_threshold - numbers.disproof + replies[best_index].proof;
+		// Staying a little past the runner up (the 1 + epsilon trick) stops the search flipping between two close replies
+		pn_t reply_disproof_threshold = (pn_t)std::min<uint64_t>(frame.proof_threshold, (uint64_t)second_disproof + second_disproof / 4 + 1);
+
+		frame.child_index = best_index;
+		frame.undo = bar.MakeMove(frame.moves[best_index]);
+
+		++stats.nodes;
+
+		if (Push(bar.TableKey(), reply_proof_threshold, reply_disproof_threshold)) {
+			return;
+		}
+
+		// Settled without a frame, so take it straight back
+		bar.UnmakeMove(frame.undo);
+		children[frame.children_begin + best_index] = result;
+	}
+};
+
+// Same result as Evaluate, proven by ProofNumberSearch instead of searching every move in order
+template <typename Table>
+float EvaluateProofNumber(const ChocolateBar& bar, SearchStats& stats, Table& table, ProofNumberTable& pn_table) {
+	ProofNumberSearch<Table> search(table, pn_table);
+
+	search.Search(bar);
+
+	stats += search.stats;
+
+	return search.Score();
+}
+
+enum SEARCH_ENGINE {
+	ENGINE_SEARCH,		// Minimax through Evaluate, kept as the reference
+	ENGINE_ANALYTIC,	// Closed form from the nim sum of the four heaps
+	ENGINE_PROOF_NUMBER	// Win/loss proof through EvaluateProofNumber
+};
+
+// Same perspective as Evaluate: 1 if the player who moved into this position wins
+// A position is lost for the player to move exactly when the nim sum of the heaps is 0
+float EvaluateAnalytic(const ChocolateBar& bar) {
+	return bar.NimSum() == 0 ? 1.0f : -1.0f;
+}
+
+Move GetAnalyticMove(const ChocolateBar& bar, float* move_score = nullptr) {
+	bar_t nim_sum = bar.NimSum();
+	std::array<bar_t, 4> heaps = bar.GetHeaps();
+
+	if (move_score != nullptr) {
+		*move_score = -1.0f;
+	}
+
+	if (bar.CheckLost()) {
+		LogError("No AI move found!");
+
+		return Move(Move::VERTICAL, 0);
+	}
+
+	// Losing position, every move is as bad as any other, so take the smallest bite
+	if (nim_sum == 0) {
+		if (bar.columns > 1) {
+			return Move(Move::VERTICAL, bar.poison_column > 0 ? 1 : bar.columns - 1);
+		}
+		else {
+			return Move(Move::HORIZONTAL, bar.poison_row > 0 ? 1 : bar.rows - 1);
+		}
+	}
+
+	if (move_score != nullptr) {
+		*move_score = 1.0f;
+	}
+
+	// Find a heap we can shrink to make the nim sum 0
+	for (int heap = 0; heap < 4; heap++) {
+		bar_t target = heaps[heap] ^ nim_sum;
+
+		if (target >= heaps[heap]) {
+			continue;
+		}
+
+		switch (heap) {
+		// Remove columns to the left of the poison
+		case 0: return Move(Move::VERTICAL, heaps[heap] - target);
+		// Keep only target columns to the right of the poison
+		case 1: return Move(Move::VERTICAL, bar.poison_column + 1 + target);
+		// Remove rows above the poison
+		case 2: return Move(Move::HORIZONTAL, heaps[heap] - target);
+		// Keep only target rows below the poison
+		case 3: return Move(Move::HORIZONTAL, bar.poison_row + 1 + target);
+		}
+	}
+
+	// Unreachable, a non-zero nim sum always has a heap with its highest bit set
+	LogError("No analytic move found!");
+
+	return Move(Move::VERTICAL, 0);
+}
+
+// Scores each root move in turn, keeping the best, until one is a proven win
+// Moves are tried starting from the search's own offset, so helpers sharing a table start on different moves,
+// after the first moves of the search's move ordering, if it has one
+// Returns the index of the best move, or possible_moves.size() if there are none or stop was set first
+template <typename Table>
+std::size_t SearchRootMoves(ChocolateBar& bar, const MoveRange& possible_moves, SearchStack<Table>& search, float& best_move_score,
+	const std::atomic<bool>* stop = nullptr)
+{
+	best_move_score = -FLT_MAX;
+	std::size_t best_move_index = possible_moves.size();
+
+	std::size_t move_offset = possible_moves.empty() ? 0 : search.GetMoveOffset(bar, possible_moves.size());
+
+	std::vector<std::size_t> root_order;
+	root_order.reserve(possible_moves.size());
+
+	if (search.ordering != nullptr && !possible_moves.empty()) {
+		std::array<std::size_t, MoveOrdering::MAX_FIRST_MOVES> first_moves;
+		std::size_t first_count = 0;
+
+		// A helper's offset move stays first, so helpers still spread out
+		if (search.helper_id != 0) {
+			first_moves[first_count++] = move_offset;
+		}
+
+		first_count = search.ordering->FirstMoves(bar, first_moves.data(), first_count);
+
+		root_order.assign(first_moves.begin(), first_moves.begin() + first_count);
+	}
+
+	std::size_t first_count = root_order.size();
+
+	for (std::size_t i = 0; i < possible_moves.size(); i++) {
+		std::size_t move_index = (i + move_offset) % possible_moves.size();
+
+		if (std::find(root_order.begin(), root_order.begin() + first_count, move_index) == root_order.begin() + first_count) {
+			root_order.push_back(move_index);
+		}
+	}
+
+	for (std::size_t i = 0; i < possible_moves.size(); i++) {
+		std::size_t move_index = root_order[i];
+
+		ChocolateBar::Undo undo = bar.MakeMove(possible_moves[move_index]);
+
+		// Only need to know if this move beats the best we've already found
+		float alpha = std::max(-1.0f, best_move_score);
+
+		search.Start(bar, alpha, 1.0f);
+
+		bool stopped = stop == nullptr ? !search.Run() : !search.RunUntilStopped(*stop);
+
+		bar.UnmakeMove(undo);
+
+		if (stopped) {
+			return possible_moves.size();
+		}
+
+		float score = search.Score();
+
+		if (score > best_move_score) {
+			best_move_score = score;
+			best_move_index = move_index;
+		}
+
+		// This move will lead to a guaranteed win, so don't process any more
+		if (score == 1.0f) {
+			LogDebug("Found guaranteed win");
+
+			search.stats.pruned += possible_moves.size() - (i + 1);
+
+			break;
+		}
+	}
+
+	if (search.ordering != nullptr && best_move_index < possible_moves.size()) {
+		search.ordering->RecordBest(bar, possible_moves[best_move_index]);
+	}
+
+	return best_move_index;
+}
+
+// Proves the starting bar, and when it's a win, the reply that proved it is the move to play
+template <typename Table>
+Move GetProofNumberMove(const ChocolateBar& bar, Table& table, ProofNumberTable& pn_table, float* move_score = nullptr, SearchStats* stats = nullptr) {
+	MoveRange possible_moves = bar.GetValidMoves();
+
+	if (move_score != nullptr) {
+		*move_score = -1.0f;
+	}
+
+	if (possible_moves.empty()) {
+		LogError("No AI move found!");
+
+		return Move(Move::VERTICAL, 0);
+	}
+
+	ProofNumberSearch<Table> search(table, pn_table);
+
+	search.Search(bar);
+
+	if (stats != nullptr) {
+		*stats += search.stats;
+	}
+
+	// Starting bar's score is for whoever moved into it, so the opposite of ours
+	if (move_score != nullptr) {
+		*move_score = -search.Score();
+	}
+
+	LogDebug("Proved in {} positions", search.stats.nodes);
+
+	return possible_moves[search.best_move_index];
+}
+
+// stats, if given, has this search's counters added to it
+// ordering, if given, picks which moves to try first, and learns from this search for the next
+// pn_table, if given, keeps ENGINE_PROOF_NUMBER's estimates between calls, otherwise each call starts its own
+template <typename Table>
+Move GetAIMove(ChocolateBar bar, Table& table, float* move_score = nullptr, SEARCH_ENGINE engine = ENGINE_SEARCH, SearchStats* stats = nullptr,
+	MoveOrdering* ordering = nullptr, ProofNumberTable* pn_table = nullptr)
+{
+	if (engine == ENGINE_ANALYTIC) {
+		PhaseTimer timer(stats, PHASE_SOLVE);
+
+		return GetAnalyticMove(bar, move_score);
+	}
+
+	if (LOADED_TABLEBASE != nullptr && LOADED_TABLEBASE->Contains(bar)) {
+		PhaseTimer timer(stats, PHASE_SOLVE);
+
+		return LOADED_TABLEBASE->GetMove(bar, move_score);
+	}
+
+	if (engine == ENGINE_PROOF_NUMBER) {
+		if (pn_table == nullptr) {
+			ProofNumberTable own_pn_table;
+
+			return GetProofNumberMove(bar, table, own_pn_table, move_score, stats);
+		}
+
+		return GetProofNumberMove(bar, table, *pn_table, move_score, stats);
+	}
+
+	MoveRange possible_moves = bar.GetValidMoves();
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	// Frames are allocated once and reused for every root move
+	SearchStack<Table> search(table, ordering);
+
+	float best_move_score = -1.0f;
+	std::size_t best_move_index = SearchRootMoves(bar, possible_moves, search, best_move_score);
+
+	if (stats != nullptr) {
+		*stats += search.stats;
+	}
+
+	if (move_score != nullptr) {
+		*move_score = best_move_index < possible_moves.size() ? best_move_score : -1.0f;
+	}
+
+	if (best_move_index == possible_moves.size()) {
+		LogError("No AI move found!");
+
+		return Move(Move::VERTICAL, 0);
+	}
+	else {
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+		float elapsed_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+		LogDebug("Searched {} positions ({} pruned) in {}ms", search.stats.nodes, search.stats.pruned, elapsed_time / 1000.0f);
+
+		return possible_moves[best_move_index];
+	}
+}
+
+// Lazy SMP: every thread searches the whole root against one shared table, each trying moves in its own order,
+// so positions solved by one thread are already in the table when the others reach them
+// Each thread's answer is complete by itself, so the first thread to finish wins and the rest are stopped
+// Suits bars with few root moves, where GetAIMoveRootParallel would leave threads idle
+Move GetAIMoveLazySMP(ChocolateBar bar, ConcurrentTranspositionTable& table, unsigned int thread_count = std::thread::hardware_concurrency(),
+	float* move_score = nullptr, SearchStats* stats = nullptr)
+{
+	if (thread_count == 0) {
+		thread_count = 1;
+	}
+
+	if (LOADED_TABLEBASE != nullptr && LOADED_TABLEBASE->Contains(bar)) {
+		PhaseTimer timer(stats, PHASE_SOLVE);
+
+		return LOADED_TABLEBASE->GetMove(bar, move_score);
+	}
+
+	MoveRange possible_moves = bar.GetValidMoves();
+
+	if (move_score != nullptr) {
+		*move_score = -1.0f;
+	}
+
+	if (possible_moves.empty()) {
+		LogError("No AI move found!");
+
+		return Move(Move::VERTICAL, 0);
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	std::atomic<bool> stop = false;
+	std::mutex result_mutex;
+
+	std::size_t best_move_index = possible_moves.size();
+	float best_move_score = -1.0f;
+	unsigned int first_helper = 0;
+	SearchStats total_stats;
+
+	auto helper = [&](unsigned int helper_id) {
+		ChocolateBar helper_bar = bar;
+
+		SearchStack<ConcurrentTranspositionTable> search(table);
+		search.helper_id = helper_id;
+
+		float score = -1.0f;
+		std::size_t move_index = SearchRootMoves(helper_bar, possible_moves, search, score, &stop);
+
+		std::lock_guard<std::mutex> lock(result_mutex);
+
+		total_stats += search.stats;
+
+		// Stopped helpers come back without a move
+		if (move_index < possible_moves.size() && !stop.exchange(true)) {
+			best_move_index = move_index;
+			best_move_score = score;
+			first_helper = helper_id;
+		}
+	};
+
+	std::vector<std::thread> helpers;
+	helpers.reserve(thread_count - 1);
+
+	for (unsigned int i = 1; i < thread_count; i++) {
+		helpers.emplace_back(helper, i);
+	}
+
+	// This thread searches in the same order as GetAIMove
+	helper(0);
+
+	for (std::thread& thread : helpers) {
+		thread.join();
+	}
+
+	if (stats != nullptr) {
+		*stats += total_stats;
+	}
+
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+	float elapsed_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+	LogDebug("Helper {} of {} finished first, {} positions searched in total in {}ms", first_helper, thread_count, total_stats.nodes, elapsed_time / 1000.0f);
+
+	if (move_score != nullptr) {
+		*move_score = best_move_score;
+	}
+
+	return possible_moves[best_move_index];
+}
+
+// What happened to one root move in GetAIMoveRootParallel
+struct RootMoveReport {
+	Move move;
+	float score = -1.0f;		// Only meaningful if searched
+	bool searched = false;		// Not searched if a sibling proved a win first
+	double elapsed_ms = 0.0;
+};
+
+// Root moves are handed out to worker threads as they free up, and all of them share one table
+// A proven win makes every other root move pointless, so the first one found stops every other worker
+// reports, if given, gets an entry per root move in GetValidMoves order
+Move GetAIMoveRootParallel(ChocolateBar bar, ConcurrentTranspositionTable& table, unsigned int thread_count = std::thread::hardware_concurrency(),
+	float* move_score = nullptr, std::vector<RootMoveReport>* reports = nullptr, SearchStats* stats = nullptr)
+{
+	if (thread_count == 0) {
+		thread_count = 1;
+	}
+
+	if (move_score != nullptr) {
+		*move_score = -1.0f;
+	}
+
+	if (LOADED_TABLEBASE != nullptr && LOADED_TABLEBASE->Contains(bar)) {
+		PhaseTimer timer(stats, PHASE_SOLVE);
+
+		return LOADED_TABLEBASE->GetMove(bar, move_score);
+	}
+
+	MoveRange possible_moves = bar.GetValidMoves();
+
+	if (possible_moves.empty()) {
+		LogError("No AI move found!");
+
+		return Move(Move::VERTICAL, 0);
+	}
+
+	std::vector<RootMoveReport> move_reports(possible_moves.size(), RootMoveReport{ possible_moves[0] });
+
+	for (std::size_t i = 0; i < possible_moves.size(); i++) {
+		move_reports[i].move = possible_moves[i];
+	}
+
+	std::atomic<std::size_t> next_move = 0;
+	std::atomic<bool> stop = false;
+	std::atomic<std::size_t> winning_move = possible_moves.size();
+
+	SearchStats total_stats;
+	std::mutex stats_mutex;
+
+	auto worker = [&]() {
+		ChocolateBar worker_bar = bar;
+		SearchStack<ConcurrentTranspositionTable> search(table);
+
+		for (std::size_t move_index = next_move++; move_index < possible_moves.size() && !stop; move_index = next_move++) {
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+			ChocolateBar::Undo undo = worker_bar.MakeMove(possible_moves[move_index]);
+
+			search.Start(worker_bar, -1.0f, 1.0f);
+
+			bool finished = search.RunUntilStopped(stop);
+
+			worker_bar.UnmakeMove(undo);
+
+			RootMoveReport& report = move_reports[move_index];
+
+			report.elapsed_ms = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0;
+
+			if (!finished) {
+				break;
+			}
+
+			report.searched = true;
+			report.score = search.Score();
+
+			// Proven win, nothing else can beat it, only the first one found is kept
+			if (report.score == 1.0f && !stop.exchange(true)) {
+				winning_move = move_index;
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(stats_mutex);
+
+		total_stats += search.stats;
+	};
+
+	std::vector<std::thread> workers;
+	workers.reserve(thread_count);
+
+	for (unsigned int i = 0; i < thread_count; i++) {
+		workers.emplace_back(worker);
+	}
+
+	for (std::thread& thread : workers) {
+		thread.join();
+	}
+
+	// No win, so every move was searched and they're all losses
+	std::size_t best_move_index = winning_move < possible_moves.size() ? winning_move.load() : 0;
+
+	std::size_t moves_searched = 0;
+
+	for (const RootMoveReport& report : move_reports) {
+		moves_searched += report.searched;
+	}
+
+	LogDebug("{} won in {}ms, {} of {} root moves searched", ReprMove(possible_moves[best_move_index]), move_reports[best_move_index].elapsed_ms,
+		moves_searched, possible_moves.size());
+
+	if (move_score != nullptr) {
+		*move_score = move_reports[best_move_index].score;
+	}
+
+	if (stats != nullptr) {
+		*stats += total_stats;
+	}
+
+	if (reports != nullptr) {
+		*reports = std::move(move_reports);
+	}
+
+	return possible_moves[best_move_index];
+}
+
+// Young Brothers Wait: a position's first move is searched alone, since that often settles the position by itself,
+// and only then are its younger brothers opened up to other threads
+// A position waiting on its brothers is a split point, kept on its owner's deque, and idle threads steal from the oldest end
+// where the subtrees are biggest. A cutoff at a split point cancels everything under it, searches notice by checking their ancestors
+// Positions below MAX_SPLIT_DEPTH are searched alone by SearchStack, splitting that far down costs more than it saves
+struct YBWCSearch {
+	static const std::size_t MAX_SPLIT_DEPTH = 24;
+	// How many positions a search below the split depth runs between checking for cancellation
+	static const std::size_t POSITIONS_PER_CHECK = 1024;
+
+	struct SplitPoint {
+		SplitPoint* parent;
+		ChocolateBar bar;
+		MoveRange moves;
+		std::size_t split_depth;
+
+		float alpha;
+
+		// Guarded by mutex, every brother narrows the window for the ones after it
+		std::mutex mutex;
+		float beta;
+		float min_score;
+
+		// The owner isn't counted in helpers, it works its own split point until the moves run out
+		std::atomic<std::size_t> next_move = 1;
+		std::atomic<int> helpers = 0;
+		std::atomic<bool> cutoff = false;
+
+		SplitPoint(SplitPoint* parent, const ChocolateBar& bar, MoveRange moves, std::size_t split_depth, float alpha, float beta, float min_score)
+			: parent(parent), bar(bar), moves(moves), split_depth(split_depth), alpha(alpha), beta(beta), min_score(min_score) {}
+
+		// Set once this or any split point above it has had a cutoff
+		bool IsCancelled() const {
+			for (const SplitPoint* split_point = this; split_point != nullptr; split_point = split_point->parent) {
+				if (split_point->cutoff.load(std::memory_order_relaxed)) {
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		bool IsBelow(const SplitPoint* ancestor) const {
+			for (const SplitPoint* split_point = parent; split_point != nullptr; split_point = split_point->parent) {
+				if (split_point == ancestor) {
+					return true;
+				}
+			}
+
+			return false;
+		}
+	};
+
+	struct Worker {
+		// Guards split_points, which are pushed and popped by the owner and read by thieves
+		std::mutex mutex;
+		std::deque<SplitPoint*> split_points;
+
+		SearchStack<ConcurrentTranspositionTable> search;
+		SearchStats stats;
+
+		Worker(ConcurrentTranspositionTable& table)
+			: search(table) {}
+	};
+
+	ConcurrentTranspositionTable& table;
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::vector<std::thread> threads;
+	std::atomic<bool> quit = false;
+
+	// Worker 0 is whichever thread calls Evaluate, the rest are started here and wait for work until destruction
+	YBWCSearch(ConcurrentTranspositionTable& table, unsigned int thread_count = std::thread::hardware_concurrency())
+		: table(table)
+	{
+		if (thread_count == 0) {
+			thread_count = 1;
+		}
+
+		for (unsigned int i = 0; i < thread_count; i++) {
+			workers.push_back(std::make_unique<Worker>(table));
+		}
+
+		for (unsigned int i = 1; i < thread_count; i++) {
+			threads.emplace_back([this, i]() {
+				while (!quit.load(std::memory_order_relaxed)) {
+					if (!TryHelp(*workers[i], nullptr)) {
+						std::this_thread::yield();
+					}
+				}
+			});
+		}
+	}
+
+	~YBWCSearch() {
+		quit = true;
+
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+	}
+
+	// Same as Evaluate, but with every worker helping, only call from one thread at a time
+	float Evaluate(const ChocolateBar& bar, float alpha = -1.0f, float beta = 1.0f) {
+		ChocolateBar search_bar = bar;
+		float score = 0.0f;
+
+		SearchNode(*workers[0], search_bar, alpha, beta, nullptr, 0, score);
+
+		return score;
+	}
+
+	// Every worker's counters added together, only valid between calls to Evaluate
+	SearchStats GetStats() const {
+		SearchStats stats;
+
+		for (const std::unique_ptr<Worker>& worker : workers) {
+			stats += worker->stats;
+			stats += worker->search.stats;
+		}
+
+		return stats;
+	}
+
+	YBWCSearch(const YBWCSearch&) = delete;
+	YBWCSearch& operator=(const YBWCSearch&) = delete;
+
+private:
+	// Score of bar for whoever moved into it, like Evaluate, parent is the nearest split point above it
+	// Returns false if a cutoff above cancelled the search, score means nothing then
+	bool SearchNode(Worker& worker, ChocolateBar& bar, float alpha, float beta, SplitPoint* parent, std::size_t split_depth, float& score) {
+		if (split_depth >= MAX_SPLIT_DEPTH) {
+			worker.search.Start(bar, alpha, beta);
+
+			while (!worker.search.Run(POSITIONS_PER_CHECK)) {
+				if (parent != nullptr && parent->IsCancelled()) {
+					return false;
+				}
+			}
+
+			score = worker.search.Score();
+
+			return true;
+		}
+
+		++worker.stats.nodes;
+		worker.stats.max_depth = std::max<uint64_t>(worker.stats.max_depth, split_depth + 1);
+
+		if (LOADED_TABLEBASE != nullptr && LOADED_TABLEBASE->Contains(bar)) {
+			score = LOADED_TABLEBASE->Evaluate(bar);
+
+			return true;
+		}
+
+		MoveRange moves = bar.GetValidMoves();
+
+		// Next person to move loses
+		if (moves.empty()) {
+			score = 1.0f;
+
+			return true;
+		}
+
+		// Eldest brother first, on its own
+		float min_score = FLT_MAX;
+
+		if (!SearchChild(worker, bar, moves[0], alpha, beta, parent, split_depth, min_score)) {
+			return false;
+		}
+
+		if (min_score <= alpha) {
+			++worker.stats.cutoffs;
+			worker.stats.pruned += moves.size() - 1;
+		}
+
+		if (min_score <= alpha || moves.size() == 1) {
+			score = min_score;
+
+			return true;
+		}
+
+		// Younger brothers can go in parallel now
+		SplitPoint split_point(parent, bar, moves, split_depth, alpha, std::min(beta, min_score), min_score);
+
+		{
+			std::lock_guard<std::mutex> lock(worker.mutex);
+
+			worker.split_points.push_back(&split_point);
+		}
+
+		WorkSplitPoint(worker, split_point, bar);
+
+		// Anything pushed after this split point was popped again before its owner returned, so it's at the back
+		{
+			std::lock_guard<std::mutex> lock(worker.mutex);
+
+			worker.split_points.pop_back();
+		}
+
+		// Only help below this split point while waiting, anything else could keep us busy long after our helpers finish
+		while (split_point.helpers.load() > 0) {
+			if (!TryHelp(worker, &split_point)) {
+				std::this_thread::yield();
+			}
+		}
+
+		if (parent != nullptr && parent->IsCancelled()) {
+			return false;
+		}
+
+		score = split_point.min_score;
+
+		return true;
+	}
+
+	// Makes move on bar, and scores it for the player making it, from the table if possible
+	// Returns false if the search was cancelled
+	bool SearchChild(Worker& worker, ChocolateBar& bar, const Move& move, float alpha, float beta, SplitPoint* parent, std::size_t split_depth,
+		float& position_score)
+	{
+		ChocolateBar::Undo undo = bar.MakeMove(move);
+
+		bool finished = true;
+
+		hash_t position_hash = bar.TableKey();
+		TranspositionTable::Entry entry = table.Lookup(position_hash);
+
+		++worker.stats.table_probes;
+
+		if (entry.isUsable(-beta, -alpha)) {
+			++worker.stats.table_hits;
+
+			position_score = -entry.score;
+		}
+		else {
+			++worker.stats.table_misses;
+
+			float child_score;
+			finished = SearchNode(worker, bar, -beta, -alpha, parent, split_depth + 1, child_score);
+
+			if (finished) {
+				table.AddEntry(position_hash, child_score, TranspositionTable::Entry::BoundForWindow(child_score, -beta, -alpha));
+
+				position_score = -child_score;
+			}
+		}
+
+		bar.UnmakeMove(undo);
+
+		return finished;
+	}
+
+	// Searches brothers from split_point until they run out or it's cancelled, bar must be in the split point's position
+	void WorkSplitPoint(Worker& worker, SplitPoint& split_point, ChocolateBar& bar) {
+		for (std::size_t move_index = split_point.next_move++; move_index < split_point.moves.size(); move_index = split_point.next_move++) {
+			if (split_point.IsCancelled()) {
+				break;
+			}
+
+			float beta;
+
+			{
+				std::lock_guard<std::mutex> lock(split_point.mutex);
+
+				beta = split_point.beta;
+			}
+
+			float position_score;
+
+			if (!SearchChild(worker, bar, split_point.moves[move_index], split_point.alpha, beta, &split_point, split_point.split_depth, position_score)) {
+				break;
+			}
+
+			std::lock_guard<std::mutex> lock(split_point.mutex);
+
+			split_point.min_score = std::min(split_point.min_score, position_score);
+
+			// Opponent has a reply at least as bad for us as a line we already have, so every other brother is pointless
+			if (split_point.min_score <= split_point.alpha) {
+				if (!split_point.cutoff.exchange(true)) {
+					++worker.stats.cutoffs;
+					worker.stats.pruned += split_point.moves.size() - std::min(split_point.next_move.load(), split_point.moves.size());
+				}
+
+				break;
+			}
+
+			split_point.beta = std::min(split_point.beta, split_point.min_score);
+		}
+	}
+
+	// Joins the oldest split point with brothers left on any other worker's deque, only ones under below if it's given
+	bool TryHelp(Worker& worker, const SplitPoint* below) {
+		for (std::unique_ptr<Worker>& victim : workers) {
+			if (victim.get() == &worker) {
+				continue;
+			}
+
+			SplitPoint* split_point = nullptr;
+
+			{
+				std::lock_guard<std::mutex> lock(victim->mutex);
+
+				for (SplitPoint* candidate : victim->split_points) {
+					if (candidate->next_move.load() < candidate->moves.size() && !candidate->IsCancelled()
+						&& (below == nullptr || candidate->IsBelow(below)))
+					{
+						// Counted while the owner can't pop it, so the owner waits for us
+						split_point = candidate;
+						++split_point->helpers;
+
+						break;
+					}
+				}
+			}
+
+			if (split_point != nullptr) {
+				ChocolateBar bar = split_point->bar;
+
+				WorkSplitPoint(worker, *split_point, bar);
+
+				--split_point->helpers;
+
+				return true;
+			}
+		}
+
+		return false;
+	}
+};
+
+// GetAIMove with each root move scored by a YBWCSearch, for bars whose few root moves leave root splitting idle
+Move GetAIMoveYBWC(ChocolateBar bar, ConcurrentTranspositionTable& table, unsigned int thread_count = std::thread::hardware_concurrency(),
+	float* move_score = nullptr, SearchStats* stats = nullptr)
+{
+	if (move_score != nullptr) {
+		*move_score = -1.0f;
+	}
+
+	if (LOADED_TABLEBASE != nullptr && LOADED_TABLEBASE->Contains(bar)) {
+		PhaseTimer timer(stats, PHASE_SOLVE);
+
+		return LOADED_TABLEBASE->GetMove(bar, move_score);
+	}
+
+	MoveRange possible_moves = bar.GetValidMoves();
+
+	if (possible_moves.empty()) {
+		LogError("No AI move found!");
+
+		return Move(Move::VERTICAL, 0);
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	YBWCSearch search(table, thread_count);
+
+	float best_move_score = -FLT_MAX;
+	std::size_t best_move_index = 0;
+
+	for (std::size_t move_index = 0; move_index < possible_moves.size(); move_index++) {
+		ChocolateBar::Undo undo = bar.MakeMove(possible_moves[move_index]);
+
+		float score = search.Evaluate(bar, std::max(-1.0f, best_move_score), 1.0f);
+
+		bar.UnmakeMove(undo);
+
+		if (score > best_move_score) {
+			best_move_score = score;
+			best_move_index = move_index;
+		}
+
+		// Guaranteed win, nothing else can beat it
+		if (score == 1.0f) {
+			break;
+		}
+	}
+
+	SearchStats search_stats = search.GetStats();
+
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+	float elapsed_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+	LogDebug("Searched {} positions on {} threads in {}ms", search_stats.nodes, search.workers.size(), elapsed_time / 1000.0f);
+
+	if (stats != nullptr) {
+		*stats += search_stats;
+	}
+
+	if (move_score != nullptr) {
+		*move_score = best_move_score;
+	}
+
+	return possible_moves[best_move_index];
+}
+
+// Limits for GetAIMoveAnytime, a limit of 0 isn't checked
+struct SearchLimits {
+	std::chrono::microseconds time_limit = std::chrono::microseconds(0);
+	std::size_t position_limit = 0;
+};
+
+// Iterative deepening: searches every move to one more frame each iteration, with anything deeper scored as unknown,
+// until a move is proven or a limit runs out. Only proven scores are stored, so each iteration picks up the last one's results
+// Returns the best move of the deepest finished iteration, proven is set if its score is certain
+template <typename Table>
+Move GetAIMoveAnytime(ChocolateBar bar, Table& table, const SearchLimits& limits, float* move_score = nullptr, bool* proven = nullptr,
+	SearchStats* stats = nullptr)
+{
+	// How many positions to search between checking the limits
+	const std::size_t POSITIONS_PER_CHECK = 1024;
+
+	if (proven != nullptr) { *proven = true; }
+
+	if (LOADED_TABLEBASE != nullptr && LOADED_TABLEBASE->Contains(bar)) {
+		PhaseTimer timer(stats, PHASE_SOLVE);
+
+		return LOADED_TABLEBASE->GetMove(bar, move_score);
+	}
+
+	MoveRange possible_moves = bar.GetValidMoves();
+
+	if (possible_moves.empty()) {
+		LogError("No AI move found!");
+
+		if (move_score != nullptr) { *move_score = -1.0f; }
+
+		return Move(Move::VERTICAL, 0);
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point deadline = start + limits.time_limit;
+
+	SearchStack<Table> search(table);
+
+	auto OutOfLimits = [&]() {
+		if (limits.position_limit != 0 && search.stats.nodes >= limits.position_limit) {
+			return true;
+		}
+
+		return limits.time_limit.count() != 0 && std::chrono::steady_clock::now() >= deadline;
+	};
+
+	// Until an iteration finishes, any move will do
+	std::size_t best_move_index = 0;
+	float best_move_score = SearchStack<Table>::UNKNOWN_SCORE;
+	bool best_proven = false;
+
+	bool out_of_limits = false;
+	std::size_t depth = 0;
+
+	while (!best_proven && !out_of_limits) {
+		float iteration_score = -FLT_MAX;
+		std::size_t iteration_index = possible_moves.size();
+		bool iteration_hit_horizon = false;
+
+		for (std::size_t move_index = 0; move_index < possible_moves.size(); move_index++) {
+			ChocolateBar::Undo undo = bar.MakeMove(possible_moves[move_index]);
+
+			float score;
+
+			// Proven by an earlier iteration
+			TranspositionTable::Entry entry = table.Lookup(bar.TableKey());
+
+			++search.stats.table_probes;
+
+			if (entry.isUsable(-1.0f, 1.0f)) {
+				++search.stats.table_hits;
+
+				score = entry.score;
+			}
+			else {
+				++search.stats.table_misses;
+
+				search.max_depth = depth;
+				search.Start(bar, std::max(-1.0f, iteration_score), 1.0f);
+
+				while (!search.Run(POSITIONS_PER_CHECK)) {
+					if (OutOfLimits()) {
+						out_of_limits = true;
+
+						break;
+					}
+				}
+
+				score = search.Score();
+				iteration_hit_horizon |= search.hit_horizon;
+			}
+
+			bar.UnmakeMove(undo);
+
+			if (out_of_limits) {
+				break;
+			}
+
+			if (score > iteration_score) {
+				iteration_score = score;
+				iteration_index = move_index;
+			}
+
+			// Proven win, nothing else can beat it
+			if (score == 1.0f) {
+				break;
+			}
+
+			// Searches of single root moves can each finish well inside POSITIONS_PER_CHECK,
+			// so a bar with many root moves would otherwise never look at the clock
+			if (move_index + 1 < possible_moves.size() && OutOfLimits()) {
+				out_of_limits = true;
+
+				break;
+			}
+		}
+
+		// An unfinished iteration is only worth using if it already proved a win
+		if (!out_of_limits || iteration_score == 1.0f) {
+			best_move_index = iteration_index;
+			best_move_score = iteration_score;
+			best_proven = iteration_score == 1.0f || !iteration_hit_horizon;
+
+			LogDebug("Depth {}: best score {}{}", depth, best_move_score, best_proven ? " (proven)" : "");
+		}
+
+		++depth;
+	}
+
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+	float elapsed_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+	LogDebug("Searched {} positions ({} pruned) to depth {} in {}ms", search.stats.nodes, search.stats.pruned, depth, elapsed_time / 1000.0f);
+
+	if (stats != nullptr) {
+		*stats += search.stats;
+	}
+
+	if (move_score != nullptr) { *move_score = best_move_score; }
+	if (proven != nullptr) { *proven = best_proven; }
+
+	return possible_moves[best_move_index];
+}
 
 Move GetPlayerMove(ChocolateBar bar) {
 	Move pending_move = Move(Move::Direction::VERTICAL, 0xffff);
 
-	while (!bar.CheckValidMove(pending_move)) {
-		std::cout << "What direction would you like to split in? (v/h) ";
-		char direction;
-		std::cin >> direction;
+	while (!bar.CheckValidMove(pending_move)) {
+		LogFlush();
+
+		std::cout << "What direction would you like to split in? (v/h) ";
+		char direction;
+		std::cin >> direction;
+
+		std::cout << std::endl << "What location would you like to split at? ";
+		bar_t location;
+		std::cin >> location;
+
+		if (direction == 'v') {
+			pending_move.dir = Move::Direction::VERTICAL;
+		}
+		else if (direction == 'h') {
+			pending_move.dir = Move::Direction::HORIZONTAL;
+		}
+		else {
+			std::cout << "Invalid direction" << std::endl;
+
+			continue;
+		}
+
+		pending_move.location = location;
+
+		if (!bar.CheckValidMove(pending_move)) {
+			std::cout << "Invalid move!" << std::endl;
+		}
+	}
+
+	return pending_move;
+}
+
+enum MOVE_ORDER {
+	AI_MOVE_FIRST,
+	AI_MOVE_SECOND
+};
+
+MOVE_ORDER PlayerSelectMoveOrder() {
+	LogFlush();
+
+	std::cout << "Would you like to move first or second? (1/2): ";
+	int order;
+	std::cin >> order;
+
+	if (order == 1) {
+		return AI_MOVE_SECOND;
+	}
+	else {
+		return AI_MOVE_FIRST;
+	}
+}
+
+// AI will calculate whether it should move first or second
+// stats, if given, has this decision's counters added to it
+// pn_table, if given, keeps ENGINE_PROOF_NUMBER's estimates between calls, otherwise each call starts its own
+template <typename Table>
+MOVE_ORDER GetAIMoveOrder(ChocolateBar bar, Table& table, SEARCH_ENGINE engine = ENGINE_SEARCH, SearchStats* stats = nullptr,
+	ProofNumberTable* pn_table = nullptr)
+{
+	bool solved = engine == ENGINE_ANALYTIC || (LOADED_TABLEBASE != nullptr && LOADED_TABLEBASE->Contains(bar));
+
+	if (solved) {
+		PhaseTimer timer(stats, PHASE_SOLVE);
+
+		// Nothing to search, moving first wins exactly when the player to move wins
+		bool first_wins = engine == ENGINE_ANALYTIC ? bar.NimSum() != 0 : LOADED_TABLEBASE->IsWin(bar);
+
+		if (first_wins) {
+			LogDebug("AI determined going first was beneficial in this position");
+
+			return AI_MOVE_FIRST;
+		}
+		else {
+			LogDebug("AI determined going second was beneficial in this position");
+
+			return AI_MOVE_SECOND;
+		}
+	}
+
+	// Table scores are for whoever moved into a position, and nobody has moved into the starting bar yet,
+	// so its stored score is exactly the score for moving second, whichever side the AI is on
+	hash_t position_hash = bar.TableKey();
+	TranspositionTable::Entry entry = table.Lookup(position_hash);
+
+	SearchStats search_stats;
+	search_stats.table_probes = 1;
+
+	float second_score;
+
+	if (entry.isUsable(-1.0f, 1.0f)) {
+		search_stats.table_hits = 1;
+
+		second_score = entry.score;
+	}
+	else {
+		search_stats.table_misses = 1;
+
+		if (engine == ENGINE_PROOF_NUMBER && pn_table == nullptr) {
+			ProofNumberTable own_pn_table;
+
+			second_score = EvaluateProofNumber(bar, search_stats, table, own_pn_table);
+		}
+		else if (engine == ENGINE_PROOF_NUMBER) {
+			second_score = EvaluateProofNumber(bar, search_stats, table, *pn_table);
+		}
+		else {
+			second_score = Evaluate(bar, search_stats, table);
+		}
+
+		table.AddEntry(position_hash, second_score, TranspositionTable::Entry::EXACT, (uint16_t)std::min<uint64_t>(search_stats.nodes, 0xffff));
+
+		LogDebug("Searched {} positions ({} pruned)", search_stats.nodes, search_stats.pruned);
+	}
+
+	if (stats != nullptr) {
+		*stats += search_stats;
+	}
+
+	float first_score = second_score * -1.0f;
+
+	LogDebug("First score: {}, Second score: {}", first_score, second_score);
+
+	if (first_score > second_score) {
+		LogDebug("AI determined going first was beneficial in this position");
+
+		return AI_MOVE_FIRST;
+	}
+	else if (second_score > first_score) {
+		LogDebug("AI determined going second was beneficial in this position");
+
+		return AI_MOVE_SECOND;
+	}
+	else {
+		LogError("AI determined no difference, defaulting to first");
+
+		return AI_MOVE_FIRST;
+	}
+}
+
+bool PlayerTurn(ChocolateBar& bar) {
+	LogFlush();
+
+	std::cout << "Human's turn!" << std::endl;
+	bar.Print();
+	Move player_move = GetPlayerMove(bar);
+	std::cout << ReprMove(player_move) << std::endl;
+	bar.MakeMove(player_move);
+
+	if (bar.CheckLost()) {
+		std::cout << "AI lost!" << std::endl;
+
+		return true;
+	}
+
+	return false;
+}
+
+bool AITurn(ChocolateBar& bar, TranspositionTable& table) {
+	LogFlush();
+
+	std::cout << "AI's turn!" << std::endl;
+	bar.Print();
+
+	// Keep the game responsive on big bars, at the cost of sometimes playing an unproven move
+	SearchLimits limits;
+	limits.time_limit = std::chrono::milliseconds(50);
+
+	bool proven = false;
+	Move ai_move = GetAIMoveAnytime(bar, table, limits, nullptr, &proven);
+
+	if (!proven) {
+		LogInfo("AI ran out of time, playing its best guess");
+	}
+
+	LogFlush();
+	std::cout << ReprMove(ai_move) << std::endl;
+	bar.MakeMove(ai_move);
+
+	if (bar.CheckLost()) {
+		std::cout << "Player lost!" << std::endl;
+
+		return true;
+	}
+
+	return false;
+}
+
+void PlayAgainstAI() {
+	ChocolateBar bar(5, 3, 2, 1);
+	// 100k possible entries
+	TranspositionTable table(100000);
+
+	bool AIMovesFirst = GetAIMoveOrder(bar, table) == AI_MOVE_FIRST;
+
+	LogInfo("\n<--- GAME STARTING --->");
+
+	while (!bar.CheckLost()) {
+		// TODO: very bad
+		if (AIMovesFirst) {
+			if (AITurn(bar, table)) { break; }
+			if (PlayerTurn(bar)) { break; }
+		}
+		else {
+			if (PlayerTurn(bar)) { break; }
+			if (AITurn(bar, table)) { break; }
+		}
+	}
+}
+
+SearchStats AITestBars() {
+	const int max_size = 11;
+
+	// Only progress and results, not the chatter from every search
+	ScopedLogLevel log_level(LOG_LEVEL_INFO);
+
+	int amount_first = 0;
+	int amount_second = 0;
+
+	float total_bars_gen = (max_size * (max_size + 1) / 2) * (max_size * (max_size + 1) / 2);
+	LogInfo("Total bars: {}", total_bars_gen);
+	int bars_counter = 0;
+	float last_percent = 0;
+
+	// Solved positions stay valid from one bar to the next
+	TranspositionTable table(100000);
+
+	SearchStats stats;
+
+	for (int rows = 1; rows <= max_size; rows++) {
+		for (int columns = 1; columns <= max_size; columns++) {
+			for (int prows = 0; prows < rows; prows++) {
+				for (int pcolumns = 0; pcolumns < columns; pcolumns++) {
+					ChocolateBar bar(columns, rows, pcolumns, prows);
+
+					MOVE_ORDER ai_move_order = GetAIMoveOrder(bar, table, ENGINE_SEARCH, &stats);
+
+					switch (ai_move_order) {
+					case AI_MOVE_FIRST: ++amount_first; break;
+					case AI_MOVE_SECOND: ++amount_second; break;
+					default: LogError("Invalid move order"); break;
+					}
+					
+					++bars_counter;
+
+					float current_percent = bars_counter / total_bars_gen;
+
+					if (current_percent - last_percent > 0.01f) {
+						PhaseTimer timer(&stats, PHASE_OUTPUT);
+
+						last_percent = current_percent;
+
+						LogInfo("{}% Done", current_percent * 100.0f);
+					}
+				}
+			}
+		}
+	}
+
+	LogInfo("Went first {} times, went second {} times", amount_first, amount_second);
+	
+	float sum_times = amount_first + amount_second;
+	float first_percent = (float)amount_first / sum_times;
+	float second_percent = (float)amount_second / sum_times;
+
+	LogInfo("Went first {}%, second {}%", first_percent * 100.0f, second_percent * 100.0f);
+	LogInfo("Evaluated {} bars total", bars_counter);
+
+	stats.Log("AITestBars");
+
+	return stats;
+}
+
+// Same sweep as AITestBars, but each (rows, columns) pair is a task pulled from a shared queue,
+// and one table is kept across every bar since each sub-bar of a bar is itself a bar in the sweep
+// Counters from every worker are added together, so phase times are summed across threads
+// table_size of 0 sizes the table to fit every position in the sweep
+SearchStats AITestBarsParallel(int max_size = 11, unsigned int thread_count = std::thread::hardware_concurrency(),
+	std::size_t table_size = 0)
+{
+	// Mirrors and transposes share an entry, leaving about max_size^4 / 4 positions,
+	// doubled so linear probing stays short. Allocating and clearing a bigger table costs more than the sweep
+	if (table_size == 0) {
+		std::size_t positions = (std::size_t)max_size * max_size * max_size * max_size / 4;
+
+		table_size = std::bit_ceil(std::max<std::size_t>(positions * 2, 1));
+	}
+
+	ConcurrentTranspositionTable table(table_size);
+
+	if (thread_count == 0) {
+		thread_count = 1;
+	}
+
+	// Only progress and results, not the chatter from every search
+	ScopedLogLevel log_level(LOG_LEVEL_INFO);
+
+	std::atomic<int> amount_first = 0;
+	std::atomic<int> amount_second = 0;
+
+	float total_bars_gen = (max_size * (max_size + 1) / 2) * (max_size * (max_size + 1) / 2);
+	LogInfo("Total bars: {}", total_bars_gen);
+	std::atomic<int> bars_counter = 0;
+	std::atomic<float> last_percent = 0;
+
+	SearchStats stats;
+	std::mutex stats_mutex;
+
+	// Largest bars first, they take longest so this keeps all workers busy until the end
+	std::atomic<int> next_task = 0;
+	const int task_count = max_size * max_size;
+
+	auto worker = [&]() {
+		SearchStats worker_stats;
+
+		for (int task = next_task++; task < task_count; task = next_task++) {
+			int rows = max_size - task / max_size;
+			int columns = max_size - task % max_size;
+
+			for (int prows = 0; prows < rows; prows++) {
+				for (int pcolumns = 0; pcolumns < columns; pcolumns++) {
+					ChocolateBar bar(columns, rows, pcolumns, prows);
+
+					if (GetAIMoveOrder(bar, table, ENGINE_SEARCH, &worker_stats) == AI_MOVE_FIRST) {
+						++amount_first;
+					}
+					else {
+						++amount_second;
+					}
+
+					float current_percent = ++bars_counter / total_bars_gen;
+					float previous_percent = last_percent.load(std::memory_order_relaxed);
+
+					// Only the worker that moves last_percent on prints, the rest carry on without waiting
+					if (current_percent - previous_percent > 0.01f
+						&& last_percent.compare_exchange_strong(previous_percent, current_percent, std::memory_order_relaxed))
+					{
+						PhaseTimer timer(&worker_stats, PHASE_OUTPUT);
+
+						LogInfo("{}% Done", current_percent * 100.0f);
+					}
+				}
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(stats_mutex);
+
+		stats += worker_stats;
+	};
+
+	std::vector<std::thread> workers;
+	workers.reserve(thread_count);
+
+	for (unsigned int i = 0; i < thread_count; i++) {
+		workers.emplace_back(worker);
+	}
+
+	for (std::thread& thread : workers) {
+		thread.join();
+	}
+
+	LogInfo("Went first {} times, went second {} times", amount_first.load(), amount_second.load());
+
+	float sum_times = amount_first + amount_second;
+	float first_percent = (float)amount_first / sum_times;
+	float second_percent = (float)amount_second / sum_times;
+
+	LogInfo("Went first {}%, second {}%", first_percent * 100.0f, second_percent * 100.0f);
+	LogInfo("Evaluated {} bars total", bars_counter.load());
+
+	stats.Log("AITestBarsParallel");
+
+	return stats;
+}
+
+// Compares the analytic engine and the proof-number search against the recursive search for every bar up to max_size
+// Returns the number of positions where the two engines disagreed
+int CrossCheckEngines(int max_size) {
+	int mismatches = 0;
+	int bars_checked = 0;
+
+	// Only ever holds estimates, never results, so sharing it between bars can't hide a disagreement
+	ProofNumberTable pn_table;
+
+	for (int rows = 1; rows <= max_size; rows++) {
+		for (int columns = 1; columns <= max_size; columns++) {
+			for (int prows = 0; prows < rows; prows++) {
+				for (int pcolumns = 0; pcolumns < columns; pcolumns++) {
+					ChocolateBar bar(columns, rows, pcolumns, prows);
+
+					TranspositionTable table(100000);
+					SearchStats stats;
+
+					float search_score = Evaluate(bar, stats, table);
+					float analytic_score = EvaluateAnalytic(bar);
+
+					// Own table, so it can't just read back what the search stored
+					TranspositionTable proof_table(100000);
+					float proof_score = EvaluateProofNumber(bar, stats, proof_table, pn_table);
+
+					bool move_mismatch = false;
+
+					// Analytic move must also be legal and lead to the score it claims
+					if (!bar.CheckLost()) {
+						float analytic_move_score = 0.0f;
+						Move analytic_move = GetAnalyticMove(bar, &analytic_move_score);
 
-		std::cout << std::endl << "What location would you like to split at? ";
-		bar_t location;
-		std::cin >> location;
+						ChocolateBar moved_bar = bar;
+						moved_bar.MakeMove(analytic_move);
 
-		if (direction == 'v') {
-			pending_move.dir = Move::Direction::VERTICAL;
-		}
-		else if (direction == 'h') {
-			pending_move.dir = Move::Direction::HORIZONTAL;
-		}
-		else {
-			std::cout << "Invalid direction" << std::endl;
+						move_mismatch = !bar.CheckValidMove(analytic_move)
+							|| EvaluateAnalytic(moved_bar) != analytic_move_score
+							|| analytic_move_score != -analytic_score;
+					}
 
-			continue;
-		}
+					if (search_score != analytic_score || search_score != proof_score || move_mismatch) {
+						++mismatches;
 
-		pending_move.location = location;
+						LogError("Engines disagree on {}x{} with poison at ({}, {}): search {}, analytic {}, proof number {}",
+							columns, rows, pcolumns, prows, search_score, analytic_score, proof_score);
+					}
 
-		if (!bar.CheckValidMove(pending_move)) {
-			std::cout << "Invalid move!" << std::endl;
+					++bars_checked;
+				}
+			}
 		}
 	}
 
-	return pending_move;
-}
+	// Tablebase is solved independently of both, so check it against the analytic engine too
+	Tablebase tablebase(max_size, max_size);
+	tablebase.Generate();
 
-enum MOVE_ORDER {
-	AI_MOVE_FIRST,
-	AI_MOVE_SECOND
-};
+	for (int rows = 1; rows <= max_size; rows++) {
+		for (int columns = 1; columns <= max_size; columns++) {
+			for (int prows = 0; prows < rows; prows++) {
+				for (int pcolumns = 0; pcolumns < columns; pcolumns++) {
+					ChocolateBar bar(columns, rows, pcolumns, prows);
 
-MOVE_ORDER PlayerSelectMoveOrder() {
-	std::cout << "Would you like to move first or second? (1/2): ";
-	int order;
-	std::cin >> order;
+					if (tablebase.Evaluate(bar) != EvaluateAnalytic(bar)) {
+						++mismatches;
 
-	if (order == 1) {
-		return AI_MOVE_SECOND;
-	}
-	else {
-		return AI_MOVE_FIRST;
+						LogError("Tablebase disagrees on {}x{} with poison at ({}, {})", columns, rows, pcolumns, prows);
+					}
+				}
+			}
+		}
 	}
+
+	LogInfo("Cross checked {} bars, {} mismatches", bars_checked, mismatches);
+
+	return mismatches;
 }
 
-// AI will calculate whether it should move first or second
-MOVE_ORDER GetAIMoveOrder(ChocolateBar bar, TranspositionTable& table) {
-	// NOTE: don't think we can reuse transposition table for this, maybe if you invert the values?
-	TranspositionTable first_table(table.table_size);
-	TranspositionTable second_table(table.table_size);
-	
-	/* -- CALCULATING SCORE WHEN MOVING FIRST -- */
-	float first_score = 0.0f;
-	GetAIMove(bar, first_table, &first_score);
+SearchStats GenerateWinMap(int columns, int rows, SEARCH_ENGINE engine = ENGINE_SEARCH) {
+	// Kept for the whole map, every cell's sub-bars overlap with its neighbours'
+	TranspositionTable table(100000);
+	// Only allocated for the engine that uses it
+	std::unique_ptr<ProofNumberTable> pn_table;
 
-	float second_score = first_score * -1.0f;
+	if (engine == ENGINE_PROOF_NUMBER) {
+		pn_table = std::make_unique<ProofNumberTable>();
+	}
 
-	Log("First score: {}, Second score: {}", first_score, second_score);
+	// Map is written straight to the console, so keep everything but problems out of it
+	ScopedLogLevel log_level(LOG_LEVEL_WARN);
+	LogFlush();
 
-	if (first_score > second_score) {
-		Log("AI determined going first was beneficial in this position");
+	SearchStats stats;
 
-		return AI_MOVE_FIRST;
+	for (int prow = 0; prow < rows; prow++) {
+		for (int pcolumn = 0; pcolumn < columns; pcolumn++) {
+			MOVE_ORDER order = GetAIMoveOrder(ChocolateBar(columns, rows, pcolumn, prow), table, engine, &stats, pn_table.get());
+
+			PhaseTimer timer(&stats, PHASE_OUTPUT);
+
+			if (order == AI_MOVE_FIRST) {
+				std::cout << "#";
+			}
+			else {
+				std::cout << "-";
+			}
+		}
+
+		PhaseTimer timer(&stats, PHASE_OUTPUT);
+
+		std::cout << std::endl;
 	}
-	else if (second_score > first_score) {
-		Log("AI determined going second was beneficial in this position");
 
-		return AI_MOVE_SECOND;
+	return stats;
+}
+
+// Same output as GenerateWinMap, but rows are handed out to worker threads as they free up,
+// and every worker shares one table so sub-positions solved for one cell are reused by all
+SearchStats GenerateWinMapParallel(int columns, int rows, SEARCH_ENGINE engine = ENGINE_SEARCH,
+	unsigned int thread_count = std::thread::hardware_concurrency(), std::size_t table_size = 0)
+{
+	// Sub-bars of every cell are sub-bars of the whole bar, about (rows * columns)^2 / 4 positions with their poison,
+	// doubled so linear probing stays short, like AITestBarsParallel. Capped, since big maps don't need every position kept
+	if (table_size == 0) {
+		static const std::size_t MAX_TABLE_SIZE = (std::size_t)1 << 23;
+
+		std::size_t cells = (std::size_t)rows * columns;
+
+		table_size = std::min(std::bit_ceil(std::max<std::size_t>(cells * cells / 2, 1)), MAX_TABLE_SIZE);
 	}
-	else {
-		Log("[ERROR] AI determined no difference, defaulting to first");
 
-		return AI_MOVE_FIRST;
+	ConcurrentTranspositionTable table(table_size);
+
+	ScopedLogLevel log_level(LOG_LEVEL_WARN);
+
+	if (thread_count == 0) {
+		thread_count = 1;
 	}
-}
 
-bool PlayerTurn(ChocolateBar& bar) {
-	std::cout << "Human's turn!" << std::endl;
-	bar.Print();
-	Move player_move = GetPlayerMove(bar);
-	std::cout << ReprMove(player_move) << std::endl;
-	bar.MakeMove(player_move);
+	// Each worker writes only the rows it claimed, so output order doesn't depend on scheduling
+	std::vector<std::string> win_map(rows, std::string(columns, ' '));
+	std::atomic<int> next_row = 0;
 
-	if (bar.CheckLost()) {
-		std::cout << "AI lost!" << std::endl;
+	SearchStats stats;
+	std::mutex stats_mutex;
 
-		return true;
+	auto worker = [&]() {
+		SearchStats worker_stats;
+
+		// Estimates aren't shared between threads, so each worker keeps its own for every row it claims
+		std::unique_ptr<ProofNumberTable> pn_table;
+
+		if (engine == ENGINE_PROOF_NUMBER) {
+			pn_table = std::make_unique<ProofNumberTable>();
+		}
+
+		for (int prow = next_row++; prow < rows; prow = next_row++) {
+			for (int pcolumn = 0; pcolumn < columns; pcolumn++) {
+				MOVE_ORDER order = GetAIMoveOrder(ChocolateBar(columns, rows, pcolumn, prow), table, engine, &worker_stats, pn_table.get());
+
+				win_map[prow][pcolumn] = order == AI_MOVE_FIRST ? '#' : '-';
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(stats_mutex);
+
+		stats += worker_stats;
+	};
+
+	std::vector<std::thread> workers;
+	workers.reserve(thread_count);
+
+	for (unsigned int i = 0; i < thread_count; i++) {
+		workers.emplace_back(worker);
 	}
 
-	return false;
-}
+	for (std::thread& thread : workers) {
+		thread.join();
+	}
 
-bool AITurn(ChocolateBar& bar, TranspositionTable& table) {
-	std::cout << "AI's turn!" << std::endl;
-	bar.Print();
-	Move ai_move = GetAIMove(bar, table);
-	std::cout << ReprMove(ai_move) << std::endl;
-	bar.MakeMove(ai_move);
+	LogFlush();
 
-	if (bar.CheckLost()) {
-		std::cout << "Player lost!" << std::endl;
+	{
+		PhaseTimer timer(&stats, PHASE_OUTPUT);
 
-		return true;
+		for (const std::string& row : win_map) {
+			std::cout << row << std::endl;
+		}
 	}
 
-	return false;
+	return stats;
 }
 
-void PlayAgainstAI() {
-	ChocolateBar bar(5, 3, 2, 1);
-	// 100k possible entries
-	TranspositionTable table(100000);
+// Win map read straight out of a tablebase, solving the tablebase is the only work
+void GenerateWinMapTablebase(int columns, int rows) {
+	// Map is written straight to the console, so keep everything but problems out of it
+	ScopedLogLevel log_level(LOG_LEVEL_WARN);
 
-	bool AIMovesFirst = GetAIMoveOrder(bar, table) == AI_MOVE_FIRST;
+	Tablebase tablebase(rows, columns);
+	tablebase.Generate();
 
-	Log("\n<--- GAME STARTING --->");
+	LogFlush();
 
-	while (!bar.CheckLost()) {
-		// TODO: very bad
-		if (AIMovesFirst) {
-			if (AITurn(bar, table)) { break; }
-			if (PlayerTurn(bar)) { break; }
-		}
-		else {
-			if (PlayerTurn(bar)) { break; }
-			if (AITurn(bar, table)) { break; }
+	for (int prow = 0; prow < rows; prow++) {
+		for (int pcolumn = 0; pcolumn < columns; pcolumn++) {
+			// AI goes first exactly when the player to move wins
+			if (tablebase.IsWin(ChocolateBar(columns, rows, pcolumn, prow))) {
+				std::cout << "#";
+			}
+			else {
+				std::cout << "-";
+			}
 		}
+
+		std::cout << std::endl;
 	}
 }
 
-void AITestBars() {
-	const int max_size = 11;
+// AITestBars as plain reads out of one tablebase covering every bar in the sweep
+void AITestBarsTablebase(int max_size = 11) {
+	Tablebase tablebase(max_size, max_size);
+	tablebase.Generate();
 
 	int amount_first = 0;
 	int amount_second = 0;
-
-	float total_bars_gen = (max_size * (max_size + 1) / 2) * (max_size * (max_size + 1) / 2);
-	std::cout << "Total bars: " << total_bars_gen << std::endl;
 	int bars_counter = 0;
-	float last_percent = 0;
 
 	for (int rows = 1; rows <= max_size; rows++) {
 		for (int columns = 1; columns <= max_size; columns++) {
 			for (int prows = 0; prows < rows; prows++) {
 				for (int pcolumns = 0; pcolumns < columns; pcolumns++) {
-					ChocolateBar bar(columns, rows, pcolumns, prows);
-
-					TranspositionTable table(100000);
-					MOVE_ORDER ai_move_order = GetAIMoveOrder(bar, table);
-
-					switch (ai_move_order) {
-					case AI_MOVE_FIRST: ++amount_first; break;
-					case AI_MOVE_SECOND: ++amount_second; break;
-					default: std::cout << "INVALID MOVE ORDER" << std::endl; break;
+					if (tablebase.IsWin(ChocolateBar(columns, rows, pcolumns, prows))) {
+						++amount_first;
 					}
-					
-					++bars_counter;
-
-					float current_percent = bars_counter / total_bars_gen;
-
-					if (current_percent - last_percent > 0.01f) {
-						last_percent = current_percent;
-
-						PRINTING_ALL = true;
-
-						Log("{}% Done", current_percent * 100.0f);
-
-						PRINTING_ALL = false;
+					else {
+						++amount_second;
 					}
+
+					++bars_counter;
 				}
 			}
 		}
 	}
 
-	PRINTING_ALL = true;
+	LogInfo("Went first {} times, went second {} times", amount_first, amount_second);
 
-	Log("Went first {} times, went second {} times", amount_first, amount_second);
-	
 	float sum_times = amount_first + amount_second;
 	float first_percent = (float)amount_first / sum_times;
 	float second_percent = (float)amount_second / sum_times;
 
-	Log("Went first {}%, second {}%", first_percent * 100.0f, second_percent * 100.0f);
-	Log("Evaluated {} bars total", bars_counter);
+	LogInfo("Went first {}%, second {}%", first_percent * 100.0f, second_percent * 100.0f);
+	LogInfo("Evaluated {} bars total", bars_counter);
 }
 
-void GenerateWinMap(int columns, int rows) {
-	TranspositionTable table(100000);
+#ifdef __BENCHMARK
+// Every allocation in the program goes through here, so workloads can report how many they made
+static std::atomic<uint64_t> ALLOCATION_COUNT = 0;
 
-	PRINTING_ALL = false;
+void* operator new(std::size_t size) {
+	++ALLOCATION_COUNT;
 
-	for (int prow = 0; prow < rows; prow++) {
-		for (int pcolumn = 0; pcolumn < columns; pcolumn++) {
-			MOVE_ORDER order = GetAIMoveOrder(ChocolateBar(columns, rows, pcolumn, prow), table);
+	if (void* memory = std::malloc(size == 0 ? 1 : size)) {
+		return memory;
+	}
 
-			if (order == AI_MOVE_FIRST) {
-				std::cout << "#";
-			}
-			else {
-				std::cout << "-";
+	throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+
+// Over-aligned types (cache line buckets) come through here instead
+void* operator new(std::size_t size, std::align_val_t alignment) {
+	++ALLOCATION_COUNT;
+
+	std::size_t align = (std::size_t)alignment;
+
+#ifdef _WIN32
+	if (void* memory = _aligned_malloc(size == 0 ? 1 : size, align)) {
+		return memory;
+	}
+#else
+	if (void* memory = std::aligned_alloc(align, (std::max<std::size_t>(size, 1) + align - 1) / align * align)) {
+		return memory;
+	}
+#endif
+
+	throw std::bad_alloc();
+}
+
+#ifdef _WIN32
+void operator delete(void* memory, std::align_val_t) noexcept { _aligned_free(memory); }
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept { _aligned_free(memory); }
+#else
+void operator delete(void* memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept { std::free(memory); }
+#endif
+
+// Swallows everything written to std::cout while a workload runs
+struct NullBuffer : std::streambuf {
+	int overflow(int c) override { return c; }
+};
+
+struct BenchmarkResult {
+	// Counters a workload can't see are left at -1 and written as null
+	std::string name;
+	double wall_ms = 0.0;
+	int64_t nodes = -1;
+	int64_t table_lookups = -1;
+	int64_t table_hits = -1;
+	int64_t cutoffs = -1;
+	int64_t max_depth = -1;
+	int64_t table_collisions = -1;
+	int64_t table_insert_failures = -1;
+	int64_t table_evictions = -1;
+	uint64_t allocations = 0;
+	std::vector<std::size_t> probe_histogram;
+
+	void SetStats(const SearchStats& stats) {
+		nodes = stats.nodes;
+		table_lookups = stats.table_probes;
+		table_hits = stats.table_hits;
+		cutoffs = stats.cutoffs;
+		max_depth = stats.max_depth;
+		table_collisions = stats.table_collisions;
+		table_insert_failures = stats.table_insert_failures;
+		table_evictions = stats.table_evictions;
+	}
+
+	static std::string OrNull(int64_t counter) {
+		return counter >= 0 ? std::to_string(counter) : "null";
+	}
+
+	std::string ToJson() const {
+		std::string nodes_per_sec = nodes >= 0 && wall_ms > 0.0 ? std::format("{}", nodes / (wall_ms / 1000.0)) : "null";
+		std::string hit_rate = table_lookups > 0 ? std::format("{}", (double)table_hits / table_lookups) : "null";
+
+		std::string histogram = "null";
+
+		if (!probe_histogram.empty()) {
+			histogram = "[";
+
+			for (std::size_t i = 0; i < probe_histogram.size(); i++) {
+				histogram += std::format("{}{}", i > 0 ? ", " : "", probe_histogram[i]);
 			}
 
-			table.Reset();
+			histogram += "]";
 		}
 
-		std::cout << std::endl;
+		return std::format("{{\"name\": \"{}\", \"wall_ms\": {}, \"nodes\": {}, \"nodes_per_sec\": {}, "
+			"\"table_lookups\": {}, \"table_hit_rate\": {}, \"cutoffs\": {}, \"max_depth\": {}, "
+			"\"table_collisions\": {}, \"table_insert_failures\": {}, \"table_evictions\": {}, \"allocations\": {}, \"probe_histogram\": {}}}",
+			name, wall_ms, OrNull(nodes), nodes_per_sec, OrNull(table_lookups), hit_rate, OrNull(cutoffs), OrNull(max_depth),
+			OrNull(table_collisions), OrNull(table_insert_failures), OrNull(table_evictions), allocations, histogram);
 	}
+};
+
+// Times a workload with std::cout silenced, workload fills in any counters it knows about
+template <typename Workload>
+BenchmarkResult RunBenchmark(const std::string& name, Workload workload) {
+	BenchmarkResult result;
+	result.name = name;
+
+	// Sink writes to std::cout from its own thread, so it has to be idle while the buffer is swapped
+	LogFlush();
+
+	NullBuffer null_buffer;
+	std::streambuf* previous_buffer = std::cout.rdbuf(&null_buffer);
+
+	uint64_t start_allocations = ALLOCATION_COUNT;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	workload(result);
+
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+	result.allocations = ALLOCATION_COUNT - start_allocations;
+	result.wall_ms = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0;
+
+	LogFlush();
+	std::cout.rdbuf(previous_buffer);
+
+	LogInfo("{}: {}ms", name, result.wall_ms);
+
+	return result;
 }
 
-#define __WINMAP
+// Fixed workloads so runs can be compared between versions of the engine, results written as JSON
+void RunBenchmarks(const std::string& output_path = "benchmark.json") {
+	// 2: table counters come from the search, a hit is a probe whose score was used
+	// 3: evaluate_ordered workloads search with every MOVE_ORDERING heuristic
+	// 4: MOVE_ORDERING is only the hash move and balance
+	// 5: table_evictions counted separately from table_insert_failures
+	static const int BENCHMARK_VERSION = 5;
+
+	std::vector<BenchmarkResult> results;
+
+	// Single searches from a cold table
+	const std::array<ChocolateBar, 4> positions = {
+		ChocolateBar(20, 20, 10, 6),
+		ChocolateBar(47, 33, 5, 20),
+		ChocolateBar(3, 64, 1, 17),
+		ChocolateBar(500, 2, 123, 0)
+	};
+
+	for (const ChocolateBar& bar : positions) {
+		std::string name = std::format("evaluate_{}x{}_{}_{}", bar.columns, bar.rows, bar.poison_column, bar.poison_row);
+
+		results.push_back(RunBenchmark(name, [&](BenchmarkResult& result) {
+			TranspositionTable table(100000);
+			SearchStats stats;
+
+			Evaluate(bar, stats, table);
+
+			result.SetStats(stats);
+			result.probe_histogram.assign(table.probe_histogram.begin(), table.probe_histogram.end());
+		}));
+
+		// Same search trying the strongest looking moves first, to see what ordering saves
+		results.push_back(RunBenchmark("evaluate_ordered_" + name.substr(name.find('_') + 1), [&](BenchmarkResult& result) {
+			TranspositionTable table(100000);
+			MoveOrdering ordering(ORDER_ALL);
+			SearchStats stats;
+
+			Evaluate(bar, stats, table, -1.0f, 1.0f, &ordering);
+
+			result.SetStats(stats);
+		}));
+
+		results.push_back(RunBenchmark("ai_move_" + name.substr(name.find('_') + 1), [&](BenchmarkResult& result) {
+			TranspositionTable table(100000);
+			SearchStats stats;
+
+			GetAIMove(bar, table, nullptr, ENGINE_SEARCH, &stats);
+
+			result.SetStats(stats);
+		}));
+
+		// Same position proven rather than searched, to compare positions expanded
+		results.push_back(RunBenchmark("prove_" + name.substr(name.find('_') + 1), [&](BenchmarkResult& result) {
+			TranspositionTable table(100000);
+			ProofNumberTable pn_table;
+			SearchStats stats;
+
+			EvaluateProofNumber(bar, stats, table, pn_table);
+
+			result.SetStats(stats);
+		}));
+	}
+
+	// Replacement schemes when the table is far too small for the search
+	const std::array<std::pair<REPLACEMENT_SCHEME, const char*>, 3> schemes = {
+		std::make_pair(REPLACE_ALWAYS, "always"),
+		std::make_pair(REPLACE_WORK_PREFERRED, "work_preferred"),
+		std::make_pair(REPLACE_TWO_TIER, "two_tier")
+	};
+
+	for (const auto& [scheme, scheme_name] : schemes) {
+		results.push_back(RunBenchmark(std::format("evaluate_bucketed_{}_30x25_5_7", scheme_name), [&](BenchmarkResult& result) {
+			BucketedTranspositionTable table(8192, scheme);
+			SearchStats stats;
+
+			Evaluate(ChocolateBar(30, 25, 5, 7), stats, table);
+
+			result.SetStats(stats);
+		}));
+	}
+
+	// 2 bit results, direct-indexed for every sub-bar of the bar being searched
+	results.push_back(RunBenchmark("evaluate_compact_47x33_5_20", [&](BenchmarkResult& result) {
+		CompactTranspositionTable table(33, 47);
+		SearchStats stats;
+
+		Evaluate(ChocolateBar(47, 33, 5, 20), stats, table);
+
+		result.SetStats(stats);
+	}));
+
+	// Whole win maps
+	for (int size : { 8, 16, 24 }) {
+		results.push_back(RunBenchmark(std::format("win_map_{}x{}", size, size), [&](BenchmarkResult& result) {
+			result.SetStats(GenerateWinMap(size, size));
+		}));
+	}
+
+	results.push_back(RunBenchmark("win_map_parallel_48x48", [&](BenchmarkResult& result) {
+		result.SetStats(GenerateWinMapParallel(48, 48));
+	}));
+
+	// Full sweep
+	results.push_back(RunBenchmark("ai_test_bars_11", [&](BenchmarkResult& result) {
+		result.SetStats(AITestBars());
+	}));
+
+	results.push_back(RunBenchmark("ai_test_bars_parallel_11", [&](BenchmarkResult& result) {
+		result.SetStats(AITestBarsParallel(11));
+	}));
+
+	std::ofstream file(output_path);
+
+	file << "{\n  \"version\": " << BENCHMARK_VERSION << ",\n  \"workloads\": [\n";
+
+	for (std::size_t i = 0; i < results.size(); i++) {
+		file << "    " << results[i].ToJson() << (i + 1 < results.size() ? ",\n" : "\n");
+	}
+
+	file << "  ]\n}\n";
+
+	LogInfo("Wrote {} benchmark results to {}", results.size(), output_path);
+}
+#endif
 
 int main(void) {
-#ifdef __WINMAP
+#ifdef __PERSISTENT_TABLEBASE
+	// Positions in here never need searching again
+	static Tablebase tablebase;
+
+	if (tablebase.LoadOrGenerate("tablebase.dbtb", 128, 128)) {
+		LOADED_TABLEBASE = &tablebase;
+	}
+#endif
+
+#if defined(__BENCHMARK)
+	RunBenchmarks();
+#elif defined(__CROSS_CHECK)
+	CrossCheckEngines(11);
+#elif defined(__WINMAP)
+	LogFlush();
+
 	std::cout << "Rows: ";
 	int rows;
 	std::cin >> rows;
@@ -616,9 +4415,21 @@ int main(void) {
 	std::cin >> columns;
 	std::cout << std::endl;
 
+#if defined(__TABLEBASE)
+	GenerateWinMapTablebase(columns, rows);
+#elif defined(__PARALLEL)
+	GenerateWinMapParallel(columns, rows);
+#else
 	GenerateWinMap(columns, rows);
+#endif
 #else
 	PlayAgainstAI();
+#if defined(__TABLEBASE)
+	AITestBarsTablebase();
+#elif defined(__PARALLEL)
+	AITestBarsParallel();
+#else
 	AITestBars();
 #endif
+#endif
 }